@@ -1,7 +1,18 @@
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
 #include <iostream>
 #include <list>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
 
 /**
  * The base Component class declares common operations for both simple and
@@ -10,7 +21,41 @@
 class Component
 {
 protected:
-    Component *parent_;
+    /**
+   * How a component's slice of the cached render relates to its current state.
+   * kUnplaced components have no slice at all: they were just added or
+   * removed, so their old text, if any, lies in another tree's buffer.
+   */
+    enum class CacheState : std::uint8_t { kClean, kDirty, kUnplaced };
+
+    Component *parent_ = nullptr;
+    mutable std::string cache_;
+    mutable std::size_t cache_offset_ = 0;
+    mutable std::size_t cache_length_ = 0;
+    mutable CacheState cache_state_ = CacheState::kUnplaced;
+
+    /**
+   * Invalidates the cached result of this component and of every ancestor.
+   * A stale node always has stale ancestors, so the walk stops at the first
+   * node that is already stale.
+   */
+    void MarkDirty() {
+        for (Component *node = this; node && node->cache_state_ == CacheState::kClean; node = node->parent_) {
+            node->cache_state_ = CacheState::kDirty;
+        }
+    }
+    /**
+   * Forgets this component's place in any cached render, when it moves into or
+   * out of a tree.
+   */
+    void Unplace() {
+        this->cache_state_ = CacheState::kUnplaced;
+        std::string().swap(this->cache_);
+    }
+    /**
+   * Brings the render cached at this root up to date. See CachedOperation().
+   */
+    void RefreshCache() const;
      /**
    * Optionally, the base Component can declare an interface for setting and
    * accessing a parent of the component in a tree structure. It can also
@@ -20,6 +65,7 @@ public:
     virtual ~Component() {}
     void SetParent(Component *parent){
         this->parent_ = parent;
+        this->Unplace();
     }
     Component *GetParetn() const {
         return this->parent_;
@@ -41,11 +87,47 @@ public:
         return false;
     }
     /**
+   * Number of components in this subtree, including this one.
+   */
+    virtual std::size_t Size() const {
+        return 1;
+    }
+    /**
    * The base Component may implement some default behavior or leave it to
    * concrete classes (by declaring the method containing the behavior as
    * "abstract").
    */
     virtual std::string Operation() const = 0;
+    /**
+   * The streaming variant appends the result to a caller-provided buffer
+   * instead of returning a fresh string, so rendering a whole tree grows one
+   * buffer rather than copying every subtree's result into its parent's.
+   */
+    virtual void Operation(std::string &out) const {
+        out += this->Operation();
+    }
+    /**
+   * Memoized Operation(). The root of the tree keeps one rendered buffer, and
+   * every component only remembers where its own text starts, relative to its
+   * parent's, and how long it is, so the cache costs O(n) memory whatever the
+   * shape of the tree. A refresh renders anew only the components on a path
+   * from a changed node to the root and copies every other subtree's text
+   * from the previous buffer. It walks iteratively, so deep chains are fine.
+   *
+   * The view stays valid until the tree is next changed or refreshed.
+   */
+    std::string_view CachedOperation() const {
+        const Component *root = this;
+        while (root->parent_) {
+            root = root->parent_;
+        }
+        root->RefreshCache();
+        std::size_t offset = 0;
+        for (const Component *node = this; node != root; node = node->parent_) {
+            offset += node->cache_offset_;
+        }
+        return std::string_view(root->cache_).substr(offset, this->cache_length_);
+    }
 
 };
 
@@ -58,9 +140,24 @@ public:
  */
 class Leaf : public Component
 {
+private:
+    std::string name_;
 public:
+    Leaf(std::string name = "Leaf")
+        : name_{std::move(name)}
+        {}
+    /**
+   * Mutating a leaf invalidates the cached results along its path to the root.
+   */
+    void SetName(std::string name) {
+        this->name_ = std::move(name);
+        this->MarkDirty();
+    }
     std::string Operation() const override {
-        return "Leaf";
+        return this->name_;
+    }
+    void Operation(std::string &out) const override {
+        out += this->name_;
     }
 };
 /**
@@ -75,6 +172,21 @@ class Composite : public Component
    */
 protected:
     std::list<Component*> children_;
+    mutable std::size_t size_ = 1;
+    mutable bool size_stale_ = false;
+
+    /**
+   * Subtree sizes are computed on demand. A change only marks the sizes of
+   * this composite and its ancestors stale, stopping at the first one that
+   * already is, like MarkDirty(), so building or editing a tree costs no more
+   * than O(1) amortized for it.
+   */
+    void MarkResized() {
+        for (Composite *node = this; node && !node->size_stale_;
+             node = static_cast<Composite*>(node->GetParetn())) {
+            node->size_stale_ = true;
+        }
+    }
 
 public:
    /**
@@ -84,6 +196,8 @@ public:
     void Add(Component *component) override {
         this->children_.push_back(component);
         component->SetParent(this);
+        this->MarkResized();
+        this->MarkDirty();
     }
       /**
    * Have in mind that this method removes the pointer to the list but doesn't
@@ -93,9 +207,20 @@ public:
     void Remove(Component *component) override {
         children_.remove(component);
         component->SetParent(nullptr);
+        this->MarkResized();
+        this->MarkDirty();
     }
     bool IsComposite() const override {
         return true;
+    }
+    /**
+   * O(1) while nothing changed below; otherwise recounts only the stale
+   * composites and reuses every other subtree's size. Not safe to call from
+   * several threads while sizes are stale.
+   */
+    std::size_t Size() const override;
+    const std::list<Component*> &GetChildren() const {
+        return this->children_;
     }
       /**
    * The Composite executes its primary logic in a particular way. It traverses
@@ -114,14 +239,552 @@ public:
         }
         return "Branch(" + result + ")";
     }
+    void Operation(std::string &out) const override {
+        out += "Branch(";
+        bool first = true;
+        for (const Component *c : children_) {
+            if (!first) {
+                out += '+';
+            }
+            first = false;
+            c->Operation(out);
+        }
+        out += ')';
+    }
 };
+
+/**
+ * A composite whose size is up to date has up-to-date sizes all the way down,
+ * so the walk only descends into stale composites, and without recursion.
+ */
+std::size_t Composite::Size() const {
+    if (!this->size_stale_) {
+        return this->size_;
+    }
+    struct Frame {
+        const Composite *node;
+        std::list<Component*>::const_iterator next;
+        std::size_t size;
+    };
+    std::vector<Frame> stack{Frame{this, this->children_.begin(), 1}};
+    for (;;) {
+        Frame &top = stack.back();
+        if (top.next == top.node->children_.end()) {
+            top.node->size_ = top.size;
+            top.node->size_stale_ = false;
+            std::size_t size = top.size;
+            stack.pop_back();
+            if (stack.empty()) {
+                return size;
+            }
+            stack.back().size += size;
+            continue;
+        }
+        const Component *child = *top.next++;
+        if (child->IsComposite() && static_cast<const Composite*>(child)->size_stale_) {
+            const Composite *composite = static_cast<const Composite*>(child);
+            stack.push_back(Frame{composite, composite->children_.begin(), 1});
+        } else {
+            top.size += child->Size();
+        }
+    }
+}
+
+/**
+ * Renders the tree rooted here into a new buffer. A clean component that has
+ * a place in the old buffer is copied from it in one piece; anything else is
+ * rendered, its children visited in turn. Every component visited gets its new
+ * offset and length, so clean subtrees keep valid offsets relative to their
+ * own roots. A frame is pushed only for composites whose text must be rebuilt.
+ */
+void Component::RefreshCache() const {
+    if (this->cache_state_ == CacheState::kClean) {
+        return;
+    }
+    struct Frame {
+        const Composite *node;
+        std::list<Component*>::const_iterator next;
+        std::size_t start;
+        std::size_t old_start;
+        bool placed;
+    };
+    std::vector<Frame> stack;
+    std::string out;
+    out.reserve(this->cache_.size());
+    auto enter = [&](const Component *c, std::size_t parent_start, std::size_t old_parent_start, bool parent_placed) {
+        bool placed = parent_placed && c->cache_state_ != CacheState::kUnplaced;
+        std::size_t old_start = old_parent_start + c->cache_offset_;
+        std::size_t start = out.size();
+        c->cache_offset_ = start - parent_start;
+        if (placed && c->cache_state_ == CacheState::kClean) {
+            out.append(this->cache_, old_start, c->cache_length_);
+            return;
+        }
+        if (c->IsComposite()) {
+            const Composite *composite = static_cast<const Composite*>(c);
+            out += "Branch(";
+            stack.push_back(Frame{composite, composite->GetChildren().begin(), start, old_start, placed});
+            return;
+        }
+        c->Operation(out);
+        c->cache_length_ = out.size() - start;
+        c->cache_state_ = CacheState::kClean;
+    };
+    this->cache_offset_ = 0;
+    enter(this, 0, 0, true);
+    while (!stack.empty()) {
+        Frame top = stack.back();
+        const std::list<Component*> &children = top.node->GetChildren();
+        if (top.next == children.end()) {
+            out += ')';
+            top.node->cache_length_ = out.size() - top.start;
+            top.node->cache_state_ = CacheState::kClean;
+            stack.pop_back();
+            continue;
+        }
+        if (top.next != children.begin()) {
+            out += '+';
+        }
+        const Component *child = *stack.back().next++;
+        enter(child, top.start, top.old_start, top.placed);
+    }
+    this->cache_.swap(out);
+}
+/**
+ * TreeWalker traverses a component tree without recursion. The path from the
+ * root to the current node lives in a heap-allocated stack of frames, one per
+ * level, each remembering the next child to visit, so the depth of the tree is
+ * bounded by memory rather than by the thread's stack. The stack is kept
+ * between walks to avoid reallocating it.
+ *
+ * Visitors are called as visit(component, depth). The optional `prune`
+ * predicate is asked about every node before it is visited; when it returns
+ * true the node and its whole subtree are skipped.
+ */
+class TreeWalker
+{
+private:
+    struct Frame {
+        const Composite *node;
+        std::list<Component*>::const_iterator next;
+    };
+    std::vector<Frame> stack_;
+
+    struct NoPrune {
+        bool operator()(const Component *, std::size_t) const {
+            return false;
+        }
+    };
+
+    void Push(const Component *component) {
+        const Composite *composite = static_cast<const Composite*>(component);
+        this->stack_.push_back(Frame{composite, composite->GetChildren().begin()});
+    }
+
+public:
+    template <typename Visit, typename Prune = NoPrune>
+    void PreOrder(const Component *root, Visit visit, Prune prune = Prune()) {
+        if (prune(root, 0)) {
+            return;
+        }
+        visit(root, 0);
+        this->stack_.clear();
+        if (root->IsComposite()) {
+            this->Push(root);
+        }
+        while (!this->stack_.empty()) {
+            Frame &top = this->stack_.back();
+            if (top.next == top.node->GetChildren().end()) {
+                this->stack_.pop_back();
+                continue;
+            }
+            const Component *child = *top.next++;
+            std::size_t depth = this->stack_.size();
+            if (prune(child, depth)) {
+                continue;
+            }
+            visit(child, depth);
+            if (child->IsComposite()) {
+                this->Push(child);
+            }
+        }
+    }
+    /**
+     * A composite is visited after all of its children, so the visitor may
+     * delete the node it is given.
+     */
+    template <typename Visit, typename Prune = NoPrune>
+    void PostOrder(const Component *root, Visit visit, Prune prune = Prune()) {
+        if (prune(root, 0)) {
+            return;
+        }
+        this->stack_.clear();
+        if (!root->IsComposite()) {
+            visit(root, 0);
+            return;
+        }
+        this->Push(root);
+        while (!this->stack_.empty()) {
+            Frame &top = this->stack_.back();
+            if (top.next == top.node->GetChildren().end()) {
+                const Composite *done = top.node;
+                this->stack_.pop_back();
+                visit(done, this->stack_.size());
+                continue;
+            }
+            const Component *child = *top.next++;
+            std::size_t depth = this->stack_.size();
+            if (prune(child, depth)) {
+                continue;
+            }
+            if (child->IsComposite()) {
+                this->Push(child);
+            } else {
+                visit(child, depth);
+            }
+        }
+    }
+    /**
+     * Breadth-first: all nodes at depth d are visited before any at depth d + 1.
+     * The queue holds one level's worth of nodes instead of one path.
+     */
+    template <typename Visit, typename Prune = NoPrune>
+    void LevelOrder(const Component *root, Visit visit, Prune prune = Prune()) {
+        std::deque<std::pair<const Component*, std::size_t>> queue{{root, 0}};
+        while (!queue.empty()) {
+            std::pair<const Component*, std::size_t> front = queue.front();
+            queue.pop_front();
+            if (prune(front.first, front.second)) {
+                continue;
+            }
+            visit(front.first, front.second);
+            if (front.first->IsComposite()) {
+                for (const Component *child : static_cast<const Composite*>(front.first)->GetChildren()) {
+                    queue.push_back({child, front.second + 1});
+                }
+            }
+        }
+    }
+    /**
+     * Same result as root->Operation(out), produced without recursing into
+     * composites. Leaves still render themselves through Operation(out).
+     */
+    void Operation(const Component *root, std::string &out) {
+        this->stack_.clear();
+        if (!root->IsComposite()) {
+            root->Operation(out);
+            return;
+        }
+        out += "Branch(";
+        this->Push(root);
+        while (!this->stack_.empty()) {
+            Frame &top = this->stack_.back();
+            const std::list<Component*> &children = top.node->GetChildren();
+            if (top.next == children.end()) {
+                out += ')';
+                this->stack_.pop_back();
+                continue;
+            }
+            if (top.next != children.begin()) {
+                out += '+';
+            }
+            const Component *child = *top.next++;
+            if (child->IsComposite()) {
+                out += "Branch(";
+                this->Push(child);
+            } else {
+                child->Operation(out);
+            }
+        }
+    }
+};
+
+/**
+ * FlatTree is an alternative storage engine for the same kind of tree. All
+ * nodes live in one contiguous array in pre-order, so a node's subtree is the
+ * index range [i, end) and its children are found by hopping from i + 1 to each
+ * child's `end`. Nodes store their kind instead of a vtable, which turns a full
+ * traversal into one linear scan with no pointer chasing and no virtual calls.
+ * Leaf names are kept back to back in one string pool, each leaf pointing at
+ * its own slice of it.
+ */
+class FlatTree
+{
+public:
+    enum class Kind : std::uint8_t { kLeaf, kComposite };
+
+    struct Node {
+        std::uint32_t parent;
+        std::uint32_t end;
+        std::uint32_t child_count;
+        std::uint32_t name_offset;
+        std::uint32_t name_length;
+        Kind kind;
+    };
+    static const std::uint32_t kNoParent = UINT32_MAX;
+
+private:
+    std::vector<Node> nodes_;
+    std::vector<std::uint32_t> open_;
+    std::string names_;
+
+    std::uint32_t Push(Kind kind) {
+        std::uint32_t index = static_cast<std::uint32_t>(this->nodes_.size());
+        std::uint32_t parent = this->open_.empty() ? kNoParent : this->open_.back();
+        if (parent != kNoParent) {
+            ++this->nodes_[parent].child_count;
+        }
+        std::uint32_t names_end = static_cast<std::uint32_t>(this->names_.size());
+        this->nodes_.push_back(Node{parent, index + 1, 0, names_end, 0, kind});
+        return index;
+    }
+    /**
+     * Makes the names appended to the pool since the last leaf was pushed the
+     * name of that leaf.
+     */
+    void NameLastLeaf() {
+        Node &leaf = this->nodes_.back();
+        leaf.name_length = static_cast<std::uint32_t>(this->names_.size()) - leaf.name_offset;
+    }
+
+public:
+    /**
+     * The tree is built in pre-order: a composite is opened, its children are
+     * added, then it is closed.
+     */
+    std::uint32_t AddLeaf(const std::string &name = "Leaf") {
+        std::uint32_t index = this->Push(Kind::kLeaf);
+        this->names_ += name;
+        this->NameLastLeaf();
+        return index;
+    }
+    std::uint32_t OpenComposite() {
+        std::uint32_t index = this->Push(Kind::kComposite);
+        this->open_.push_back(index);
+        return index;
+    }
+    void CloseComposite() {
+        this->nodes_[this->open_.back()].end = static_cast<std::uint32_t>(this->nodes_.size());
+        this->open_.pop_back();
+    }
+    void Reserve(std::size_t nodes) {
+        this->nodes_.reserve(nodes);
+    }
+    /**
+     * Flattens a pointer tree. Every component that isn't a composite is
+     * recorded as a leaf named by its Operation(out).
+     */
+    static FlatTree FromComponent(const Component *root) {
+        FlatTree tree;
+        std::vector<std::pair<const Component*, bool>> stack{{root, false}};
+        while (!stack.empty()) {
+            std::pair<const Component*, bool> top = stack.back();
+            stack.pop_back();
+            if (top.second) {
+                tree.CloseComposite();
+            } else if (top.first->IsComposite()) {
+                tree.OpenComposite();
+                stack.push_back({top.first, true});
+                const std::list<Component*> &children =
+                    static_cast<const Composite*>(top.first)->GetChildren();
+                for (auto it = children.rbegin(); it != children.rend(); ++it) {
+                    stack.push_back({*it, false});
+                }
+            } else {
+                tree.Push(Kind::kLeaf);
+                top.first->Operation(tree.names_);
+                tree.NameLastLeaf();
+            }
+        }
+        return tree;
+    }
+    std::size_t size() const {
+        return this->nodes_.size();
+    }
+    const Node &node(std::uint32_t index) const {
+        return this->nodes_[index];
+    }
+    std::string name(std::uint32_t index) const {
+        const Node &node = this->nodes_[index];
+        return this->names_.substr(node.name_offset, node.name_length);
+    }
+    /**
+     * Same result as Component::Operation() on the equivalent pointer tree,
+     * produced by a single pass over the array. A node is its parent's first
+     * child exactly when the parent sits right before it.
+     */
+    std::string Operation() const {
+        std::string result;
+        result.reserve(this->nodes_.size() * 2 + this->names_.size());
+        this->Operation(result);
+        return result;
+    }
+    void Operation(std::string &result) const {
+        std::vector<std::uint32_t> open;
+        for (std::uint32_t i = 0; i < this->nodes_.size(); ++i) {
+            const Node &node = this->nodes_[i];
+            while (!open.empty() && i >= this->nodes_[open.back()].end) {
+                result += ')';
+                open.pop_back();
+            }
+            if (node.parent != kNoParent && node.parent != i - 1) {
+                result += '+';
+            }
+            if (node.kind == Kind::kLeaf) {
+                result.append(this->names_, node.name_offset, node.name_length);
+            } else {
+                result += "Branch(";
+                open.push_back(i);
+            }
+        }
+        result.append(open.size(), ')');
+    }
+};
+
+/**
+ * ForkJoinPool runs tasks on `threads - 1` worker threads plus whichever thread
+ * is waiting on a TaskGroup: Wait() keeps executing queued tasks until its own
+ * group is done, so nested fork-join never deadlocks on a fixed pool.
+ */
+class ForkJoinPool
+{
+private:
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+
+public:
+    ForkJoinPool(std::size_t threads) {
+        for (std::size_t i = 1; i < threads; ++i) {
+            this->workers_.emplace_back([this] {
+                for (;;) {
+                    std::function<void()> task;
+                    {
+                        std::unique_lock<std::mutex> lock(this->mutex_);
+                        this->cv_.wait(lock, [this] { return this->stop_ || !this->tasks_.empty(); });
+                        if (this->tasks_.empty()) {
+                            return;
+                        }
+                        task = std::move(this->tasks_.front());
+                        this->tasks_.pop_front();
+                    }
+                    task();
+                }
+            });
+        }
+    }
+    ~ForkJoinPool() {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex_);
+            this->stop_ = true;
+        }
+        this->cv_.notify_all();
+        for (std::thread &worker : this->workers_) {
+            worker.join();
+        }
+    }
+    void Submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex_);
+            this->tasks_.push_back(std::move(task));
+        }
+        this->cv_.notify_one();
+    }
+    /**
+     * Runs the most recently queued task on the calling thread, if any.
+     */
+    bool RunOne() {
+        std::function<void()> task;
+        {
+            std::lock_guard<std::mutex> lock(this->mutex_);
+            if (this->tasks_.empty()) {
+                return false;
+            }
+            task = std::move(this->tasks_.back());
+            this->tasks_.pop_back();
+        }
+        task();
+        return true;
+    }
+};
+
+class TaskGroup
+{
+private:
+    ForkJoinPool &pool_;
+    std::atomic<std::size_t> pending_{0};
+
+public:
+    TaskGroup(ForkJoinPool &pool)
+        : pool_{pool}
+        {}
+    ~TaskGroup() {
+        this->Wait();
+    }
+    void Run(std::function<void()> task) {
+        this->pending_.fetch_add(1);
+        this->pool_.Submit([this, task = std::move(task)] {
+            task();
+            this->pending_.fetch_sub(1);
+        });
+    }
+    void Wait() {
+        while (this->pending_.load() != 0) {
+            if (!this->pool_.RunOne()) {
+                std::this_thread::yield();
+            }
+        }
+    }
+};
+
+/**
+ * Parallel version of Operation(out). Every child subtree bigger than `grain`
+ * components becomes its own task rendering into its own buffer; smaller ones
+ * are rendered inline. The buffers are joined in child order, so the result is
+ * identical to the sequential one. The first Size() call, made before any task
+ * starts, brings every size in the subtree up to date, so tasks only read them.
+ */
+void ParallelOperation(const Component *component, ForkJoinPool &pool, std::size_t grain,
+                       std::string &out) {
+    if (!component->IsComposite() || component->Size() <= grain) {
+        component->Operation(out);
+        return;
+    }
+    std::deque<std::string> parts(1);
+    {
+        TaskGroup group(pool);
+        parts.back() += "Branch(";
+        bool first = true;
+        for (const Component *c : static_cast<const Composite*>(component)->GetChildren()) {
+            if (!first) {
+                parts.back() += '+';
+            }
+            first = false;
+            if (c->Size() > grain) {
+                parts.emplace_back();
+                std::string *slot = &parts.back();
+                group.Run([c, &pool, grain, slot] { ParallelOperation(c, pool, grain, *slot); });
+                parts.emplace_back();
+            } else {
+                c->Operation(parts.back());
+            }
+        }
+        parts.back() += ')';
+    }
+    for (const std::string &part : parts) {
+        out += part;
+    }
+}
+
 /**
  * The client code works with all of the components via the base interface.
  */
 
 void ClientCode(Component *component){
     //...
-    std::cout << "RESULT: " << component->Operation();
+    std::cout << "RESULT: " << component->CachedOperation();
     //...
 }
 /**
@@ -133,14 +796,287 @@ void ClientCode2(Component *component1, Component *component2){
     if(component1->IsComposite()){
         component1->Add(component2);
     }
-    std::cout << "RESULT: " << component1->Operation();
+    std::cout << "RESULT: " << component1->CachedOperation();
+}
+
+/**
+ * Builds a pointer tree of `nodes` components in which every composite has up
+ * to `fanout` children and the remaining budget is split evenly between them.
+ */
+Component *NewLeaf() {
+    return new Leaf;
+}
+
+Component *BuildTree(std::size_t nodes, std::size_t fanout, Component *(*make_leaf)() = NewLeaf) {
+    if (nodes <= 1) {
+        return make_leaf();
+    }
+    Component *composite = new Composite;
+    std::size_t budget = nodes - 1;
+    std::size_t children = std::min(fanout, budget);
+    for (std::size_t i = 0; i < children; ++i) {
+        std::size_t share = budget / (children - i);
+        composite->Add(BuildTree(share, fanout, make_leaf));
+        budget -= share;
+    }
+    return composite;
+}
+
+/**
+ * Deletes a whole tree bottom-up. It walks iteratively, so even a chain far
+ * deeper than the thread's stack can be freed.
+ */
+void DeleteTree(Component *component) {
+    TreeWalker walker;
+    walker.PostOrder(component, [](const Component *c, std::size_t) { delete c; });
+}
+
+/**
+ * Times a full-tree Operation() on the pointer tree and on its FlatTree copy.
+ */
+void BenchmarkFlatTree(std::size_t nodes) {
+    using Clock = std::chrono::steady_clock;
+    Component *tree = BuildTree(nodes, 8);
+    auto start = Clock::now();
+    FlatTree flat = FlatTree::FromComponent(tree);
+    double flatten_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    start = Clock::now();
+    std::string pointer_result = tree->Operation();
+    double pointer_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    start = Clock::now();
+    std::string flat_result = flat.Operation();
+    double flat_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    std::cout << nodes << " nodes" << (pointer_result == flat_result ? "" : " (MISMATCH)") << "\n"
+              << "  pointer tree Operation: " << pointer_ms << " ms\n"
+              << "  flat tree Operation:    " << flat_ms << " ms (flattening took "
+              << flatten_ms << " ms)\n";
+    DeleteTree(tree);
+}
+
+/**
+ * A chain of `depth` nested composites, each holding a leaf and the next link.
+ */
+Component *BuildChain(std::size_t depth) {
+    Component *node = new Leaf;
+    for (std::size_t i = 0; i < depth; ++i) {
+        Component *link = new Composite;
+        link->Add(new Leaf);
+        link->Add(node);
+        node = link;
+    }
+    return node;
+}
+
+/**
+ * Compares the string-returning Operation() with the streaming one on a deep
+ * and on a wide tree.
+ */
+void BenchmarkStreamingOperation(const char *shape, Component *tree) {
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+    std::string concatenated = tree->Operation();
+    double concat_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    start = Clock::now();
+    std::string streamed;
+    tree->Operation(streamed);
+    double stream_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::cout << shape << ", " << streamed.size() << " output bytes"
+              << (concatenated == streamed ? "" : " (MISMATCH)") << "\n"
+              << "  Operation():    " << concat_ms << " ms\n"
+              << "  Operation(out): " << stream_ms << " ms\n";
+    DeleteTree(tree);
+}
+
+/**
+ * A leaf whose work is expensive enough for parallelism to matter.
+ */
+class HeavyLeaf : public Leaf
+{
+public:
+    void Operation(std::string &out) const override {
+        std::uint64_t h = reinterpret_cast<std::uintptr_t>(this);
+        for (int i = 0; i < 20000; ++i) {
+            h = (h ^ (h >> 29)) * 0xBF58476D1CE4E5B9ull;
+        }
+        out += (h == 42 ? "Leaf!" : "Leaf");
+    }
+    std::string Operation() const override {
+        std::string out;
+        this->Operation(out);
+        return out;
+    }
+};
+
+Component *NewHeavyLeaf() {
+    return new HeavyLeaf;
+}
+
+/**
+ * A skewed tree: at every level most of the nodes go into the last child, and
+ * a few small subtrees hang beside it.
+ */
+Component *BuildSkewedTree(std::size_t nodes) {
+    if (nodes <= 64) {
+        return BuildTree(nodes, 8, NewHeavyLeaf);
+    }
+    Component *composite = new Composite;
+    std::size_t small = (nodes - 1) / 16;
+    for (int i = 0; i < 3; ++i) {
+        composite->Add(BuildTree(small, 8, NewHeavyLeaf));
+    }
+    composite->Add(BuildSkewedTree(nodes - 1 - 3 * small));
+    return composite;
+}
+
+/**
+ * Times ParallelOperation() over 1, 2, 4, ... threads, up to the number of
+ * hardware threads (and at least 4).
+ */
+void BenchmarkParallelOperation(const char *shape, Component *tree) {
+    using Clock = std::chrono::steady_clock;
+    std::string expected;
+    auto start = Clock::now();
+    tree->Operation(expected);
+    double sequential_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::cout << shape << ", " << tree->Size() << " nodes: sequential " << sequential_ms << " ms\n";
+    std::size_t max_threads = std::max<std::size_t>(4, std::thread::hardware_concurrency());
+    for (std::size_t threads = 1; threads <= max_threads; threads *= 2) {
+        ForkJoinPool pool(threads);
+        std::string result;
+        start = Clock::now();
+        ParallelOperation(tree, pool, 256, result);
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        std::cout << "  " << threads << " threads: " << ms << " ms, speedup "
+                  << sequential_ms / ms << (result == expected ? "" : " (MISMATCH)") << "\n";
+    }
+    DeleteTree(tree);
+}
+
+void CollectLeaves(Component *component, std::vector<Leaf*> &leaves) {
+    if (component->IsComposite()) {
+        for (Component *child : static_cast<Composite*>(component)->GetChildren()) {
+            CollectLeaves(child, leaves);
+        }
+    } else {
+        leaves.push_back(static_cast<Leaf*>(component));
+    }
+}
+
+/**
+ * Renames one random leaf and re-renders the whole tree, `updates` times, with
+ * a full Operation(out) and with CachedOperation().
+ */
+void BenchmarkCachedOperation(std::size_t nodes, int updates) {
+    using Clock = std::chrono::steady_clock;
+    Component *tree = BuildTree(nodes, 8);
+    std::vector<Leaf*> leaves;
+    CollectLeaves(tree, leaves);
+    tree->CachedOperation();
+
+    auto start = Clock::now();
+    std::size_t bytes = 0;
+    for (int i = 0; i < updates; ++i) {
+        leaves[static_cast<std::size_t>(std::rand()) % leaves.size()]->SetName(i % 2 ? "Leaf" : "Fern");
+        std::string result;
+        tree->Operation(result);
+        bytes += result.size();
+    }
+    double full_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    start = Clock::now();
+    for (int i = 0; i < updates; ++i) {
+        leaves[static_cast<std::size_t>(std::rand()) % leaves.size()]->SetName(i % 2 ? "Leaf" : "Fern");
+        bytes += tree->CachedOperation().size();
+    }
+    double cached_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::cout << nodes << " nodes, " << updates << " one-leaf updates, each followed by a full render\n"
+              << "  Operation(out):    " << full_ms / updates << " ms per update\n"
+              << "  CachedOperation(): " << cached_ms / updates << " ms per update\n";
+    DeleteTree(tree);
+}
+
+std::size_t CountLeavesRecursively(const Component *component) {
+    if (!component->IsComposite()) {
+        return 1;
+    }
+    std::size_t leaves = 0;
+    for (const Component *child : static_cast<const Composite*>(component)->GetChildren()) {
+        leaves += CountLeavesRecursively(child);
+    }
+    return leaves;
+}
+
+/**
+ * Compares TreeWalker with plain recursion, rendering the tree and counting
+ * its leaves, then counts again with the subtrees below depth 3 pruned. Deep
+ * trees have to stay shallow enough for the recursive side to survive.
+ */
+void BenchmarkTraversal(const char *shape, Component *tree) {
+    using Clock = std::chrono::steady_clock;
+    TreeWalker walker;
+    auto start = Clock::now();
+    std::string recursive;
+    tree->Operation(recursive);
+    double recursive_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    start = Clock::now();
+    std::string iterative;
+    walker.Operation(tree, iterative);
+    double iterative_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    start = Clock::now();
+    std::size_t recursive_leaves = CountLeavesRecursively(tree);
+    double recursive_count_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    start = Clock::now();
+    std::size_t leaves = 0;
+    walker.PreOrder(tree, [&leaves](const Component *c, std::size_t) { leaves += !c->IsComposite(); });
+    double preorder_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    start = Clock::now();
+    std::size_t shallow = 0;
+    walker.PreOrder(tree, [&shallow](const Component *, std::size_t) { ++shallow; },
+                    [](const Component *, std::size_t depth) { return depth > 3; });
+    double pruned_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    std::cout << shape << ", " << tree->Size() << " nodes"
+              << (recursive == iterative && recursive_leaves == leaves ? "" : " (MISMATCH)") << "\n"
+              << "  recursive Operation(out):   " << recursive_ms << " ms\n"
+              << "  TreeWalker::Operation:      " << iterative_ms << " ms\n"
+              << "  recursive leaf count:       " << recursive_count_ms << " ms\n"
+              << "  TreeWalker::PreOrder count: " << preorder_ms << " ms\n"
+              << "  PreOrder pruned at depth 3: " << pruned_ms << " ms (" << shallow << " nodes)\n";
+    DeleteTree(tree);
+}
+
+/**
+ * A chain far too deep for recursion, rendered by TreeWalker and through the
+ * cache, then freed by TreeWalker.
+ */
+void BenchmarkDeepChain(std::size_t depth) {
+    using Clock = std::chrono::steady_clock;
+    Component *chain = BuildChain(depth);
+    TreeWalker walker;
+    auto start = Clock::now();
+    std::string result;
+    walker.Operation(chain, result);
+    double render_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    start = Clock::now();
+    bool same = chain->CachedOperation() == result;
+    double cached_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    start = Clock::now();
+    DeleteTree(chain);
+    double delete_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::cout << "chain of " << depth << " nested composites, " << result.size() << " output bytes"
+              << (same ? "" : " (MISMATCH)") << "\n"
+              << "  TreeWalker::Operation: " << render_ms << " ms\n"
+              << "  first CachedOperation: " << cached_ms << " ms\n"
+              << "  DeleteTree:            " << delete_ms << " ms\n";
 }
 
 /**
  * This way the client code can support the simple leaf components...
  */
 
-int main()
+int main(int argc, char *argv[])
 {
     Component *simple = new Leaf;
     std::cout << "Client: I've got a simple component:\n";
@@ -167,6 +1103,60 @@ int main()
               << " even when managing the tree:\n";
     ClientCode2(tree, simple);
     std::cout << "\n";
+
+    std::cout << "\nClient: The same tree in flat storage:\n";
+    std::cout << "RESULT: " << FlatTree::FromComponent(tree).Operation() << "\n";
+
+    std::cout << "\nClient: The same tree rendered by a pool of 4 threads:\n";
+    {
+        ForkJoinPool pool(4);
+        std::string result;
+        ParallelOperation(tree, pool, 2, result);
+        std::cout << "RESULT: " << result << "\n";
+    }
+
+    std::cout << "\nClient: Renaming one leaf only recomputes its path to the root:\n";
+    static_cast<Leaf*>(leaf_3)->SetName("Fern");
+    ClientCode(tree);
+    std::cout << "\n";
+    std::cout << "Client: The renamed tree renders the same in flat storage: "
+              << (FlatTree::FromComponent(tree).Operation() == tree->Operation() ? "yes" : "NO") << "\n";
+
+    std::cout << "\nClient: The same tree walked without recursion:\n";
+    {
+        TreeWalker walker;
+        auto print = [](const Component *c, std::size_t) {
+            std::cout << " " << (c->IsComposite() ? "Branch" : c->Operation());
+        };
+        std::cout << "pre-order:  ";
+        walker.PreOrder(tree, print);
+        std::cout << "\npost-order: ";
+        walker.PostOrder(tree, print);
+        std::cout << "\nlevel-order:";
+        walker.LevelOrder(tree, print);
+        std::cout << "\nshallower than depth 2:";
+        walker.PreOrder(tree, print, [](const Component *, std::size_t depth) { return depth >= 2; });
+        std::string result;
+        walker.Operation(tree, result);
+        std::cout << "\nRESULT: " << result << "\n";
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        std::cout << "\n";
+        BenchmarkFlatTree(1000000);
+        BenchmarkFlatTree(10000000);
+        BenchmarkStreamingOperation("deep tree (chain of 10000 composites)", BuildChain(10000));
+        BenchmarkStreamingOperation("wide tree (1000000 leaves under one root)", BuildTree(1000001, 1000000));
+        BenchmarkStreamingOperation("balanced tree (1000000 nodes, fanout 8)", BuildTree(1000000, 8));
+        std::cout << "hardware threads: " << std::thread::hardware_concurrency() << "\n";
+        BenchmarkParallelOperation("balanced tree", BuildTree(50000, 8, NewHeavyLeaf));
+        BenchmarkParallelOperation("skewed tree", BuildSkewedTree(50000));
+        BenchmarkCachedOperation(1000000, 200);
+        BenchmarkTraversal("deep tree (chain of 10000 composites)", BuildChain(10000));
+        BenchmarkTraversal("balanced tree (fanout 8)", BuildTree(1000000, 8));
+        BenchmarkTraversal("bushy tree (fanout 64)", BuildTree(1000000, 64));
+        BenchmarkDeepChain(1000000);
+    }
     
     delete simple;
     delete tree;
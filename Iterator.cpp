@@ -5,66 +5,232 @@
  * underlying representation (list, stack, tree, etc.).
  */
 
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <numeric>
+#include <ranges>
+#include <shared_mutex>
+#include <span>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#include <x86intrin.h>
+#endif
+
 /**
  * C++ has its own implementation of iterator that works with a different
  * generics containers defined by the standard library.
+ *
+ * This Iterator is a thin wrapper over the container's own begin()/end(); code
+ * that cares about speed should use those directly, since one-call-per-step
+ * traversal through a heap-allocated object keeps the loop from vectorizing.
+ *
+ * A reverse iterator walks from the last element to the first. It keeps m_it_
+ * one past the current element, so it never has to step before begin().
  */
 
 template <typename T, typename U>
 class Iterator {
  public:
-  typedef typename std::vector<T>::iterator iter_type;
-  Iterator(U *p_data, bool reverse = false) : m_p_data_(p_data) {
-    m_it_ = m_p_data_->m_data_.begin();
+  typedef typename U::iterator iter_type;
+  Iterator(U *p_data, bool reverse = false) : m_p_data_(p_data), m_reverse_(reverse) {
+    First();
   }
 
   void First() {
-    m_it_ = m_p_data_->m_data_.begin();
+    m_it_ = m_reverse_ ? m_p_data_->end() : m_p_data_->begin();
   }
 
   void Next() {
-    m_it_++;
+    if (m_reverse_) {
+      m_it_--;
+    } else {
+      m_it_++;
+    }
   }
 
   bool IsDone() {
-    return (m_it_ == m_p_data_->m_data_.end());
+    return (m_it_ == (m_reverse_ ? m_p_data_->begin() : m_p_data_->end()));
   }
 
   iter_type Current() {
-    return m_it_;
+    return m_reverse_ ? std::prev(m_it_) : m_it_;
+  }
+
+  /**
+   * Returns up to `n` elements starting at the current position and moves past
+   * them; the span is empty once the iterator is done. A reverse iterator hands
+   * out blocks from the back, but each block is still in memory order.
+   */
+  std::span<T> NextBatch(std::size_t n) {
+    std::size_t offset = static_cast<std::size_t>(m_it_ - m_p_data_->begin());
+    if (m_reverse_) {
+      std::size_t take = std::min(n, offset);
+      m_it_ -= static_cast<std::ptrdiff_t>(take);
+      return std::span<T>(m_p_data_->data() + offset - take, take);
+    }
+    std::size_t take = std::min(n, m_p_data_->size() - offset);
+    m_it_ += static_cast<std::ptrdiff_t>(take);
+    return std::span<T>(m_p_data_->data() + offset, take);
   }
 
  private:
   U *m_p_data_;
+  bool m_reverse_;
   iter_type m_it_;
 };
 
+/**
+ * A SplitRange is a slice [begin, end) of a container that is traversed either
+ * forward or backward and can be cut into smaller slices for parallel work.
+ * Splitting always preserves traversal order: visiting the pieces one after
+ * another visits the same elements in the same order as the whole range.
+ */
+
+template <typename It>
+class SplitRange {
+ public:
+  SplitRange(It begin, It end, bool reverse = false) : m_begin_(begin), m_end_(end), m_reverse_(reverse) {}
+
+  std::size_t size() const {
+    return static_cast<std::size_t>(m_end_ - m_begin_);
+  }
+
+  bool reverse() const {
+    return m_reverse_;
+  }
+
+  bool IsDivisible(std::size_t grain) const {
+    return size() > grain;
+  }
+
+  /**
+   * Keeps the first half (in traversal order) in this range and returns the
+   * second half.
+   */
+  SplitRange Split() {
+    It mid = m_begin_ + static_cast<std::ptrdiff_t>(size() / 2);
+    if (m_reverse_) {
+      SplitRange rest(m_begin_, mid, true);
+      m_begin_ = mid;
+      return rest;
+    }
+    SplitRange rest(mid, m_end_, false);
+    m_end_ = mid;
+    return rest;
+  }
+
+  /**
+   * Cuts the range into `n` chunks whose sizes differ by at most one, listed in
+   * traversal order.
+   */
+  std::vector<SplitRange> Partition(std::size_t n) const {
+    std::vector<SplitRange> chunks;
+    chunks.reserve(n);
+    std::size_t total = size();
+    for (std::size_t i = 0; i < n; i++) {
+      auto lo = static_cast<std::ptrdiff_t>(i * total / n);
+      auto hi = static_cast<std::ptrdiff_t>((i + 1) * total / n);
+      if (m_reverse_) {
+        chunks.emplace_back(m_end_ - hi, m_end_ - lo, true);
+      } else {
+        chunks.emplace_back(m_begin_ + lo, m_begin_ + hi, false);
+      }
+    }
+    return chunks;
+  }
+
+  template <typename F>
+  void ForEach(F &&f) const {
+    if (m_reverse_) {
+      for (It it = m_end_; it != m_begin_;) {
+        f(*--it);
+      }
+    } else {
+      for (It it = m_begin_; it != m_end_; ++it) {
+        f(*it);
+      }
+    }
+  }
+
+ private:
+  It m_begin_;
+  It m_end_;
+  bool m_reverse_;
+};
+
 /**
  * Generic Collections/Containers provides one or several methods for retrieving
  * fresh iterator instances, compatible with the collection class.
+ *
+ * The elements are stored contiguously, and begin()/end() hand out contiguous
+ * iterators, so the container works with range-for, <algorithm> and
+ * std::ranges.
  */
 
 template <class T>
 class Container {
-  friend class Iterator<T, Container>;
-
  public:
+  typedef typename std::vector<T>::iterator iterator;
+  typedef typename std::vector<T>::const_iterator const_iterator;
+
   void Add(T a) {
     m_data_.push_back(a);
   }
 
-  Iterator<T, Container> *CreateIterator() {
-    return new Iterator<T, Container>(this);
+  void Reserve(std::size_t n) {
+    m_data_.reserve(n);
+  }
+
+  Iterator<T, Container> *CreateIterator(bool reverse = false) {
+    return new Iterator<T, Container>(this, reverse);
   }
 
+  SplitRange<iterator> Range(bool reverse = false) {
+    return SplitRange<iterator>(begin(), end(), reverse);
+  }
+
+  iterator begin() { return m_data_.begin(); }
+  iterator end() { return m_data_.end(); }
+  const_iterator begin() const { return m_data_.begin(); }
+  const_iterator end() const { return m_data_.end(); }
+  T *data() { return m_data_.data(); }
+  const T *data() const { return m_data_.data(); }
+  std::size_t size() const { return m_data_.size(); }
+
  private:
   std::vector<T> m_data_;
 };
 
+static_assert(std::ranges::contiguous_range<Container<int>>);
+static_assert(std::ranges::sized_range<const Container<int>>);
+
 class Data {
  public:
   Data(int a = 0) : m_data_(a) {}
@@ -73,7 +239,7 @@ class Data {
     m_data_ = a;
   }
 
-  int data() {
+  int data() const {
     return m_data_;
   }
 
@@ -81,6 +247,1209 @@ class Data {
   int m_data_;
 };
 
+/**
+ * SoaTraits<T> describes how a record type is stored column by column: the
+ * field types as a tuple, how to Split a record into them and how to Join them
+ * back. Specialize it to make a type usable with SoaContainer.
+ */
+template <typename T>
+struct SoaTraits;
+
+template <>
+struct SoaTraits<Data> {
+  typedef std::tuple<int> Fields;
+
+  static Fields Split(const Data &a) {
+    return Fields(a.data());
+  }
+
+  static Data Join(const Fields &fields) {
+    return Data(std::get<0>(fields));
+  }
+};
+
+template <typename Tuple>
+struct ColumnsOf;
+
+template <typename... F>
+struct ColumnsOf<std::tuple<F...>> {
+  typedef std::tuple<std::vector<F>...> type;
+};
+
+/**
+ * A structure-of-arrays container: every field of T lives in its own vector,
+ * so a scan over one field touches only that field's memory. Column<I>() hands
+ * out a contiguous span of field I. Whole records are reached through a proxy
+ * Reference, which reads and writes the fields in place and converts to and
+ * from T when needed.
+ */
+template <class T>
+class SoaContainer {
+ public:
+  typedef typename SoaTraits<T>::Fields Fields;
+  static constexpr std::size_t kColumns = std::tuple_size_v<Fields>;
+  template <std::size_t I>
+  using Field = std::tuple_element_t<I, Fields>;
+
+  class Reference {
+   public:
+    Reference(SoaContainer *container, std::size_t index) : m_container_(container), m_index_(index) {}
+
+    template <std::size_t I>
+    Field<I> &get() const {
+      return std::get<I>(m_container_->m_columns_)[m_index_];
+    }
+
+    operator T() const {
+      return SoaTraits<T>::Join(m_container_->Gather(m_index_, std::make_index_sequence<kColumns>()));
+    }
+
+    const Reference &operator=(const T &a) const {
+      m_container_->Scatter(m_index_, SoaTraits<T>::Split(a), std::make_index_sequence<kColumns>());
+      return *this;
+    }
+
+   private:
+    SoaContainer *m_container_;
+    std::size_t m_index_;
+  };
+
+  /**
+   * Walks whole records; dereferencing yields a Reference rather than a T&.
+   */
+  class iterator {
+   public:
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef Reference reference;
+
+    iterator() = default;
+    iterator(SoaContainer *container, std::size_t index) : m_container_(container), m_index_(index) {}
+
+    Reference operator*() const {
+      return Reference(m_container_, m_index_);
+    }
+
+    iterator &operator++() {
+      m_index_++;
+      return *this;
+    }
+
+    iterator operator++(int) {
+      iterator old = *this;
+      m_index_++;
+      return old;
+    }
+
+    bool operator==(const iterator &other) const {
+      return m_index_ == other.m_index_;
+    }
+
+   private:
+    SoaContainer *m_container_ = nullptr;
+    std::size_t m_index_ = 0;
+  };
+
+  void Add(const T &a) {
+    Push(SoaTraits<T>::Split(a), std::make_index_sequence<kColumns>());
+  }
+
+  void Reserve(std::size_t n) {
+    std::apply([n](auto &...column) { (column.reserve(n), ...); }, m_columns_);
+  }
+
+  std::size_t size() const {
+    return std::get<0>(m_columns_).size();
+  }
+
+  template <std::size_t I>
+  std::span<Field<I>> Column() {
+    return std::get<I>(m_columns_);
+  }
+
+  template <std::size_t I>
+  std::span<const Field<I>> Column() const {
+    return std::get<I>(m_columns_);
+  }
+
+  Reference operator[](std::size_t i) {
+    return Reference(this, i);
+  }
+
+  iterator begin() { return iterator(this, 0); }
+  iterator end() { return iterator(this, size()); }
+
+ private:
+  template <std::size_t... I>
+  void Push(Fields &&fields, std::index_sequence<I...>) {
+    (std::get<I>(m_columns_).push_back(std::get<I>(std::move(fields))), ...);
+  }
+
+  template <std::size_t... I>
+  Fields Gather(std::size_t index, std::index_sequence<I...>) const {
+    return Fields(std::get<I>(m_columns_)[index]...);
+  }
+
+  template <std::size_t... I>
+  void Scatter(std::size_t index, Fields &&fields, std::index_sequence<I...>) {
+    ((std::get<I>(m_columns_)[index] = std::get<I>(std::move(fields))), ...);
+  }
+
+  typename ColumnsOf<Fields>::type m_columns_;
+};
+
+static_assert(std::ranges::contiguous_range<decltype(std::declval<SoaContainer<Data> &>().Column<0>())>);
+static_assert(std::forward_iterator<SoaContainer<Data>::iterator>);
+
+/**
+ * MappedContainer<T> is a Container whose elements live in a file of raw T
+ * records, mapped into memory instead of loaded, so the data set can be larger
+ * than RAM. Opened read-only, it is a view of an existing file. In append mode
+ * Add() writes new records at the end; the file grows in doubling steps and is
+ * trimmed back to the records actually written when the container is closed.
+ * Add() may move the mapping, which invalidates iterators and data().
+ *
+ * The file starts with a header holding the number of committed records, and
+ * only those are ever read back. The header fills one page of the host that
+ * created the file, so the records start on a page boundary there; its size is
+ * stored in the header, so a file stays readable on hosts with other page
+ * sizes. Commit() first syncs the records
+ * to disk and only then raises the count, so the zero-filled room the file
+ * grows into, or records added since the last Commit(), never reappear as data
+ * after a crash. Closing the container commits.
+ */
+template <class T>
+class MappedContainer {
+  static_assert(std::is_trivially_copyable_v<T>, "records are stored as raw bytes");
+
+ public:
+  enum class Mode { kReadOnly, kAppend };
+
+  /**
+   * Hands out records in order and, every `kWindow` bytes, asks the kernel to
+   * start reading the next windows ahead (MADV_WILLNEED) and to drop the
+   * window just passed from this process (MADV_DONTNEED), so a scan over a
+   * huge file keeps a bounded resident set.
+   */
+  class iterator {
+   public:
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+
+    iterator() = default;
+    iterator(const T *begin, const T *p, const T *end) : m_begin_(begin), m_p_(p), m_end_(end), m_next_advice_(p) {
+      Advise();
+    }
+
+    const T &operator*() const { return *m_p_; }
+    const T *operator->() const { return m_p_; }
+
+    iterator &operator++() {
+      if (++m_p_ == m_next_advice_) {
+        Advise();
+      }
+      return *this;
+    }
+
+    iterator operator++(int) {
+      iterator old = *this;
+      ++*this;
+      return old;
+    }
+
+    bool operator==(const iterator &other) const { return m_p_ == other.m_p_; }
+
+   private:
+    /**
+     * Windows are counted from the page holding the first record. That page
+     * lies inside the mapping, so every advised range is page aligned and none
+     * reaches outside it, wherever the header ends.
+     */
+    void Advise() {
+      if (m_p_ == m_end_) {
+        return;
+      }
+      auto page = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+      std::uintptr_t base = reinterpret_cast<std::uintptr_t>(m_begin_) & ~(page - 1);
+      std::uintptr_t here = base + ((reinterpret_cast<std::uintptr_t>(m_p_) - base) & ~(kWindow - 1));
+      std::uintptr_t end = reinterpret_cast<std::uintptr_t>(m_end_);
+      if (here >= base + kWindow) {
+        madvise(reinterpret_cast<void *>(here - kWindow), kWindow, MADV_DONTNEED);
+      }
+      std::uintptr_t ahead = std::min(here + kWindow * (kAhead + 1), end);
+      madvise(reinterpret_cast<void *>(here), ahead - here, MADV_WILLNEED);
+      std::uintptr_t next = here + kWindow;
+      std::size_t records = (next - reinterpret_cast<std::uintptr_t>(m_p_) + sizeof(T) - 1) / sizeof(T);
+      m_next_advice_ = next >= end ? m_end_ : m_p_ + records;
+    }
+
+    const T *m_begin_ = nullptr;
+    const T *m_p_ = nullptr;
+    const T *m_end_ = nullptr;
+    const T *m_next_advice_ = nullptr;
+  };
+
+  MappedContainer(const std::string &path, Mode mode = Mode::kReadOnly) : m_mode_(mode) {
+    m_fd_ = open(path.c_str(), mode == Mode::kAppend ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+    if (m_fd_ < 0) {
+      throw std::runtime_error("MappedContainer: cannot open " + path);
+    }
+    try {
+      Open(path);
+    } catch (...) {
+      if (m_base_) {
+        munmap(m_base_, m_header_bytes_ + m_capacity_ * sizeof(T));
+      }
+      close(m_fd_);
+      throw;
+    }
+  }
+
+  ~MappedContainer() {
+    if (m_mode_ == Mode::kAppend) {
+      try {
+        Commit();
+      } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+      }
+    }
+    std::uint64_t committed = Header()->count;
+    munmap(m_base_, m_header_bytes_ + m_capacity_ * sizeof(T));
+    if (m_mode_ == Mode::kAppend) {
+      if (ftruncate(m_fd_, static_cast<off_t>(m_header_bytes_ + committed * sizeof(T))) != 0) {
+        std::cerr << "MappedContainer: cannot trim file" << std::endl;
+      }
+    }
+    close(m_fd_);
+  }
+
+  MappedContainer(const MappedContainer &) = delete;
+  MappedContainer &operator=(const MappedContainer &) = delete;
+
+  void Add(const T &a) {
+    if (m_mode_ != Mode::kAppend) {
+      throw std::runtime_error("MappedContainer: opened read-only");
+    }
+    if (m_size_ == m_capacity_) {
+      Map(m_capacity_ * 2);
+    }
+    std::memcpy(static_cast<void *>(m_data_ + m_size_), &a, sizeof(T));
+    m_size_++;
+  }
+
+  /**
+   * Makes every record added so far durable: the records are synced first and
+   * the header's count is raised and synced after them.
+   */
+  void Commit() {
+    if (m_mode_ != Mode::kAppend || Header()->count == m_size_) {
+      return;
+    }
+    auto page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    std::size_t from = (m_header_bytes_ + Header()->count * sizeof(T)) / page * page;
+    if (msync(m_base_ + from, m_header_bytes_ + m_size_ * sizeof(T) - from, MS_SYNC) != 0) {
+      throw std::runtime_error("MappedContainer: cannot sync records");
+    }
+    Header()->count = m_size_;
+    if (msync(m_base_, sizeof(FileHeader), MS_SYNC) != 0) {
+      throw std::runtime_error("MappedContainer: cannot sync header");
+    }
+  }
+
+  std::size_t size() const { return m_size_; }
+  // Bytes before the first record in the file.
+  std::size_t header_bytes() const { return m_header_bytes_; }
+  const T *data() const { return m_data_; }
+  iterator begin() const { return iterator(m_data_, m_data_, m_data_ + m_size_); }
+  iterator end() const { return iterator(m_data_, m_data_ + m_size_, m_data_ + m_size_); }
+
+ private:
+  struct FileHeader {
+    char magic[8];
+    std::uint64_t record_size;
+    std::uint64_t header_bytes;
+    std::uint64_t count;
+  };
+
+  static constexpr char kMagic[8] = {'M', 'A', 'P', 'P', 'E', 'D', 'C', '2'};
+  static constexpr std::uintptr_t kWindow = 4 << 20;
+  static constexpr std::uintptr_t kAhead = 4;
+  static constexpr std::size_t kMinCapacity = (1 << 20) / sizeof(T) + 1;
+
+  FileHeader *Header() const { return reinterpret_cast<FileHeader *>(m_base_); }
+
+  /**
+   * Reads or, for a new file in append mode, writes the header, and maps the
+   * committed records. Whatever lies past them is room to append into.
+   */
+  void Open(const std::string &path) {
+    struct stat st;
+    if (fstat(m_fd_, &st) != 0) {
+      throw std::runtime_error("MappedContainer: cannot stat " + path);
+    }
+    auto file_bytes = static_cast<std::size_t>(st.st_size);
+    if (file_bytes == 0 && m_mode_ == Mode::kAppend) {
+      m_header_bytes_ = std::max(static_cast<std::size_t>(sysconf(_SC_PAGESIZE)), sizeof(FileHeader));
+      Map(kMinCapacity);
+      std::memcpy(Header()->magic, kMagic, sizeof(kMagic));
+      Header()->record_size = sizeof(T);
+      Header()->header_bytes = m_header_bytes_;
+      Header()->count = 0;
+      return;
+    }
+    FileHeader header;
+    if (file_bytes < sizeof(header) || pread(m_fd_, &header, sizeof(header), 0) != sizeof(header) ||
+        std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.record_size != sizeof(T) ||
+        header.header_bytes < sizeof(header) || header.header_bytes % alignof(T) != 0 ||
+        header.header_bytes > file_bytes || header.count > (file_bytes - header.header_bytes) / sizeof(T)) {
+      throw std::runtime_error("MappedContainer: " + path + " is not a file of these records");
+    }
+    m_header_bytes_ = static_cast<std::size_t>(header.header_bytes);
+    m_size_ = static_cast<std::size_t>(header.count);
+    if (m_mode_ == Mode::kAppend) {
+      Map(std::max(m_size_, kMinCapacity));
+    } else {
+      Map(m_size_);
+    }
+  }
+
+  /**
+   * Maps the header and the first `capacity` records of the file, growing the
+   * file first in append mode. An existing mapping is moved with mremap.
+   */
+  void Map(std::size_t capacity) {
+    std::size_t bytes = m_header_bytes_ + capacity * sizeof(T);
+    if (m_mode_ == Mode::kAppend && ftruncate(m_fd_, static_cast<off_t>(bytes)) != 0) {
+      throw std::runtime_error("MappedContainer: cannot grow file");
+    }
+    void *memory;
+    if (m_base_) {
+      memory = mremap(m_base_, m_header_bytes_ + m_capacity_ * sizeof(T), bytes, MREMAP_MAYMOVE);
+    } else if (m_mode_ == Mode::kAppend) {
+      memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd_, 0);
+    } else {
+      memory = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, m_fd_, 0);
+    }
+    if (memory == MAP_FAILED) {
+      throw std::runtime_error("MappedContainer: mmap failed");
+    }
+    madvise(memory, bytes, MADV_SEQUENTIAL);
+    m_base_ = static_cast<char *>(memory);
+    m_data_ = reinterpret_cast<T *>(m_base_ + m_header_bytes_);
+    m_capacity_ = capacity;
+  }
+
+  Mode m_mode_;
+  int m_fd_ = -1;
+  char *m_base_ = nullptr;
+  std::size_t m_header_bytes_ = 0;
+  T *m_data_ = nullptr;
+  std::size_t m_size_ = 0;
+  std::size_t m_capacity_ = 0;
+};
+
+static_assert(std::forward_iterator<MappedContainer<Data>::iterator>);
+
+/**
+ * ConcurrentContainer<T> is an append-only container that can be read while it
+ * grows. Elements live in segments that are never moved or freed before the
+ * container itself: segment 0 holds kFirstSegment elements and every following
+ * segment twice as many as the one before, so an index maps to its segment
+ * with one bit_width and there are few segments even for huge sizes.
+ *
+ * Add() fills the next slot and only then publishes the new size with a release
+ * store. Writers take a mutex among themselves; readers never do. A Snapshot
+ * reads the size once when it is created and only ever looks at that prefix,
+ * which is fully written and never changes, so readers see a consistent view
+ * without blocking writers and without being invalidated by them.
+ */
+template <class T>
+class ConcurrentContainer {
+ public:
+  static constexpr std::size_t kFirstSegment = 1024;
+  static constexpr std::size_t kMaxSegments = 40;
+
+  class Snapshot;
+
+  ConcurrentContainer() {
+    for (std::atomic<T *> &segment : m_segments_) {
+      segment.store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  ~ConcurrentContainer() {
+    std::size_t size = m_size_.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < size; i++) {
+      Slot(i)->~T();
+    }
+    for (std::atomic<T *> &segment : m_segments_) {
+      ::operator delete(segment.load(std::memory_order_relaxed), std::align_val_t(alignof(T)));
+    }
+  }
+
+  ConcurrentContainer(const ConcurrentContainer &) = delete;
+  ConcurrentContainer &operator=(const ConcurrentContainer &) = delete;
+
+  void Add(T a) {
+    std::lock_guard<std::mutex> lock(m_write_mutex_);
+    std::size_t size = m_size_.load(std::memory_order_relaxed);
+    std::size_t segment = SegmentOf(size);
+    if (size == SegmentStart(segment)) {
+      if (segment == kMaxSegments) {
+        throw std::length_error("ConcurrentContainer: full");
+      }
+      void *memory = ::operator new(SegmentSize(segment) * sizeof(T), std::align_val_t(alignof(T)));
+      m_segments_[segment].store(static_cast<T *>(memory), std::memory_order_relaxed);
+    }
+    new (Slot(size)) T(std::move(a));
+    m_size_.store(size + 1, std::memory_order_release);
+  }
+
+  std::size_t size() const {
+    return m_size_.load(std::memory_order_acquire);
+  }
+
+  Snapshot snapshot() const {
+    return Snapshot(this, size());
+  }
+
+  /**
+   * A read-only view of the first size() elements as they were when the
+   * snapshot was taken. Iterating it is safe while other threads keep adding.
+   */
+  class Snapshot {
+   public:
+    class iterator {
+     public:
+      typedef T value_type;
+      typedef std::ptrdiff_t difference_type;
+
+      iterator() = default;
+      iterator(const ConcurrentContainer *container, std::size_t index, std::size_t size)
+          : m_container_(container), m_index_(index) {
+        if (index < size) {
+          std::size_t segment = SegmentOf(index);
+          m_p_ = container->Slot(index);
+          m_segment_end_ = container->Slot(SegmentStart(segment)) + SegmentSize(segment);
+        }
+      }
+
+      const T &operator*() const { return *m_p_; }
+      const T *operator->() const { return m_p_; }
+
+      iterator &operator++() {
+        if (++m_p_ == m_segment_end_) {
+          std::size_t segment = SegmentOf(m_index_ + 1);
+          m_p_ = m_container_->m_segments_[segment].load(std::memory_order_relaxed);
+          m_segment_end_ = m_p_ ? m_p_ + SegmentSize(segment) : nullptr;
+        }
+        m_index_++;
+        return *this;
+      }
+
+      iterator operator++(int) {
+        iterator old = *this;
+        ++*this;
+        return old;
+      }
+
+      bool operator==(const iterator &other) const { return m_index_ == other.m_index_; }
+
+     private:
+      const ConcurrentContainer *m_container_ = nullptr;
+      std::size_t m_index_ = 0;
+      const T *m_p_ = nullptr;
+      const T *m_segment_end_ = nullptr;
+    };
+
+    std::size_t size() const { return m_size_; }
+    const T &operator[](std::size_t i) const { return *m_container_->Slot(i); }
+    iterator begin() const { return iterator(m_container_, 0, m_size_); }
+    iterator end() const { return iterator(m_container_, m_size_, m_size_); }
+
+    /**
+     * Calls f with the snapshot's elements one contiguous segment at a time,
+     * for kernels that want spans (see IntKernels).
+     */
+    template <typename F>
+    void ForEachSpan(F &&f) const {
+      for (std::size_t segment = 0; SegmentStart(segment) < m_size_; segment++) {
+        std::size_t start = SegmentStart(segment);
+        std::size_t count = std::min(SegmentSize(segment), m_size_ - start);
+        f(std::span<const T>(m_container_->Slot(start), count));
+      }
+    }
+
+   private:
+    friend class ConcurrentContainer;
+    Snapshot(const ConcurrentContainer *container, std::size_t size) : m_container_(container), m_size_(size) {}
+
+    const ConcurrentContainer *m_container_;
+    std::size_t m_size_;
+  };
+
+ private:
+  static std::size_t SegmentOf(std::size_t index) {
+    return static_cast<std::size_t>(std::bit_width(index / kFirstSegment + 1)) - 1;
+  }
+
+  static std::size_t SegmentStart(std::size_t segment) {
+    return kFirstSegment * ((std::size_t{1} << segment) - 1);
+  }
+
+  static std::size_t SegmentSize(std::size_t segment) {
+    return kFirstSegment << segment;
+  }
+
+  T *Slot(std::size_t index) const {
+    std::size_t segment = SegmentOf(index);
+    return m_segments_[segment].load(std::memory_order_relaxed) + (index - SegmentStart(segment));
+  }
+
+  std::atomic<T *> m_segments_[kMaxSegments];
+  std::atomic<std::size_t> m_size_{0};
+  std::mutex m_write_mutex_;
+};
+
+static_assert(std::forward_iterator<ConcurrentContainer<int>::Snapshot::iterator>);
+
+/**
+ * Lazy adaptors. `cont | Filter(p) | Transform(f) | Take(n)` builds a nest of
+ * small view objects; nothing runs until the result is iterated, and iterating
+ * it is one loop in which every stage is a template parameter, so the compiler
+ * inlines all of them. No stage allocates or makes a virtual call.
+ *
+ * Every view iterator knows where its input ends and compares equal to
+ * std::default_sentinel when done, so views are iterated with range-for as
+ * begin() ... std::default_sentinel. Views hold their input by value and only
+ * refer to containers, which therefore have to outlive them.
+ */
+struct LazyView {};
+
+template <typename It>
+class Subrange : public LazyView {
+ public:
+  Subrange(It begin, It end) : m_begin_(begin), m_end_(end) {}
+
+  class iterator {
+   public:
+    iterator(It it, It end) : m_it_(it), m_end_(end) {}
+    decltype(auto) operator*() const { return *m_it_; }
+    iterator &operator++() {
+      ++m_it_;
+      return *this;
+    }
+    bool operator==(std::default_sentinel_t) const { return m_it_ == m_end_; }
+
+    /**
+     * With a random access iterator, ChunkView can cut the next `n` elements
+     * off as a plain Subrange and skip past them in one step, instead of
+     * walking every chunk twice.
+     */
+    Subrange Prefix(std::size_t n) const requires std::random_access_iterator<It> {
+      return Subrange(m_it_, m_it_ + Clamp(n));
+    }
+    void Advance(std::size_t n) requires std::random_access_iterator<It> {
+      m_it_ += Clamp(n);
+    }
+
+   private:
+    std::ptrdiff_t Clamp(std::size_t n) const {
+      return static_cast<std::ptrdiff_t>(std::min<std::size_t>(n, static_cast<std::size_t>(m_end_ - m_it_)));
+    }
+    It m_it_;
+    It m_end_;
+  };
+
+  iterator begin() const { return iterator(m_begin_, m_end_); }
+  std::default_sentinel_t end() const { return std::default_sentinel; }
+
+ private:
+  It m_begin_;
+  It m_end_;
+};
+
+/**
+ * Views pass through unchanged; anything else with begin()/end() is wrapped.
+ */
+template <typename R>
+auto All(R &&r) {
+  if constexpr (std::is_base_of_v<LazyView, std::remove_cvref_t<R>>) {
+    return std::remove_cvref_t<R>(std::forward<R>(r));
+  } else {
+    return Subrange<decltype(r.begin())>(r.begin(), r.end());
+  }
+}
+
+template <typename V, typename P>
+class FilterView : public LazyView {
+ public:
+  FilterView(V base, P pred) : m_base_(std::move(base)), m_pred_(std::move(pred)) {}
+
+  class iterator {
+   public:
+    typedef decltype(std::declval<V &>().begin()) BaseIt;
+    iterator(BaseIt it, const P *pred) : m_it_(std::move(it)), m_pred_(pred) { Skip(); }
+    decltype(auto) operator*() const { return *m_it_; }
+    iterator &operator++() {
+      ++m_it_;
+      Skip();
+      return *this;
+    }
+    bool operator==(std::default_sentinel_t) const { return m_it_ == std::default_sentinel; }
+
+   private:
+    void Skip() {
+      while (!(m_it_ == std::default_sentinel) && !(*m_pred_)(*m_it_)) {
+        ++m_it_;
+      }
+    }
+    BaseIt m_it_;
+    const P *m_pred_;
+  };
+
+  iterator begin() { return iterator(m_base_.begin(), &m_pred_); }
+  std::default_sentinel_t end() const { return std::default_sentinel; }
+
+ private:
+  V m_base_;
+  P m_pred_;
+};
+
+template <typename V, typename F>
+class TransformView : public LazyView {
+ public:
+  TransformView(V base, F f) : m_base_(std::move(base)), m_f_(std::move(f)) {}
+
+  class iterator {
+   public:
+    typedef decltype(std::declval<V &>().begin()) BaseIt;
+    iterator(BaseIt it, const F *f) : m_it_(std::move(it)), m_f_(f) {}
+    decltype(auto) operator*() const { return (*m_f_)(*m_it_); }
+    iterator &operator++() {
+      ++m_it_;
+      return *this;
+    }
+    bool operator==(std::default_sentinel_t) const { return m_it_ == std::default_sentinel; }
+
+   private:
+    BaseIt m_it_;
+    const F *m_f_;
+  };
+
+  iterator begin() { return iterator(m_base_.begin(), &m_f_); }
+  std::default_sentinel_t end() const { return std::default_sentinel; }
+
+ private:
+  V m_base_;
+  F m_f_;
+};
+
+/**
+ * The first `n` elements of the input. Its iterator doubles as the element
+ * type of ChunkView.
+ */
+template <typename V>
+class TakeView : public LazyView {
+ public:
+  typedef decltype(std::declval<V &>().begin()) BaseIt;
+
+  class iterator {
+   public:
+    iterator(BaseIt it, std::size_t left) : m_it_(std::move(it)), m_left_(left) {}
+    decltype(auto) operator*() const { return *m_it_; }
+    iterator &operator++() {
+      ++m_it_;
+      --m_left_;
+      return *this;
+    }
+    bool operator==(std::default_sentinel_t) const { return m_left_ == 0 || m_it_ == std::default_sentinel; }
+
+   private:
+    BaseIt m_it_;
+    std::size_t m_left_;
+  };
+
+  TakeView(V base, std::size_t n) : m_base_(std::move(base)), m_n_(n) {}
+
+  iterator begin() { return iterator(m_base_.begin(), m_n_); }
+  std::default_sentinel_t end() const { return std::default_sentinel; }
+
+ private:
+  V m_base_;
+  std::size_t m_n_;
+};
+
+/**
+ * Pairs up elements of two inputs and stops at the shorter one. Elements are
+ * std::pairs of the inputs' references.
+ */
+template <typename V1, typename V2>
+class ZipView : public LazyView {
+ public:
+  ZipView(V1 first, V2 second) : m_first_(std::move(first)), m_second_(std::move(second)) {}
+
+  class iterator {
+   public:
+    typedef decltype(std::declval<V1 &>().begin()) FirstIt;
+    typedef decltype(std::declval<V2 &>().begin()) SecondIt;
+    iterator(FirstIt first, SecondIt second) : m_first_(std::move(first)), m_second_(std::move(second)) {}
+    auto operator*() const { return std::pair<decltype(*m_first_), decltype(*m_second_)>(*m_first_, *m_second_); }
+    iterator &operator++() {
+      ++m_first_;
+      ++m_second_;
+      return *this;
+    }
+    bool operator==(std::default_sentinel_t) const {
+      return m_first_ == std::default_sentinel || m_second_ == std::default_sentinel;
+    }
+
+   private:
+    FirstIt m_first_;
+    SecondIt m_second_;
+  };
+
+  iterator begin() { return iterator(m_first_.begin(), m_second_.begin()); }
+  std::default_sentinel_t end() const { return std::default_sentinel; }
+
+ private:
+  V1 m_first_;
+  V2 m_second_;
+};
+
+/**
+ * Splits the input into consecutive groups of `n` > 0 elements (the last one
+ * may be shorter). Each group is itself a lazy range over the input, so nothing is
+ * copied. Over a Subrange a chunk is a prefix and moving to the next one is a
+ * jump, so iterating the chunks walks the input once. Any other input is
+ * walked twice, once by the chunk and once to step past it, so it must allow
+ * more than one pass and its elements are computed twice.
+ */
+template <typename V>
+class ChunkView : public LazyView {
+ public:
+  typedef decltype(std::declval<V &>().begin()) BaseIt;
+
+  class Chunk {
+   public:
+    Chunk(BaseIt it, std::size_t n) : m_it_(std::move(it)), m_n_(n) {}
+    typename TakeView<V>::iterator begin() const { return typename TakeView<V>::iterator(m_it_, m_n_); }
+    std::default_sentinel_t end() const { return std::default_sentinel; }
+
+   private:
+    BaseIt m_it_;
+    std::size_t m_n_;
+  };
+
+  class iterator {
+   public:
+    iterator(BaseIt it, std::size_t n) : m_it_(std::move(it)), m_n_(n) {}
+    auto operator*() const {
+      if constexpr (requires { m_it_.Prefix(m_n_); }) {
+        return m_it_.Prefix(m_n_);
+      } else {
+        return Chunk(m_it_, m_n_);
+      }
+    }
+    iterator &operator++() {
+      if constexpr (requires { m_it_.Advance(m_n_); }) {
+        m_it_.Advance(m_n_);
+      } else {
+        for (std::size_t i = 0; i < m_n_ && !(m_it_ == std::default_sentinel); i++) {
+          ++m_it_;
+        }
+      }
+      return *this;
+    }
+    bool operator==(std::default_sentinel_t) const { return m_it_ == std::default_sentinel; }
+
+   private:
+    BaseIt m_it_;
+    std::size_t m_n_;
+  };
+
+  ChunkView(V base, std::size_t n) : m_base_(std::move(base)), m_n_(n) {}
+
+  iterator begin() { return iterator(m_base_.begin(), m_n_); }
+  std::default_sentinel_t end() const { return std::default_sentinel; }
+
+ private:
+  V m_base_;
+  std::size_t m_n_;
+};
+
+/**
+ * The right-hand side of `range | Adaptor`: holds a function that wraps the
+ * range's view in the next one.
+ */
+template <typename Make>
+struct Adaptor {
+  Make make;
+};
+
+template <typename R, typename Make>
+auto operator|(R &&r, Adaptor<Make> adaptor) {
+  return adaptor.make(All(std::forward<R>(r)));
+}
+
+template <typename P>
+auto Filter(P pred) {
+  auto make = [pred](auto base) { return FilterView<decltype(base), P>(std::move(base), pred); };
+  return Adaptor<decltype(make)>{make};
+}
+
+template <typename F>
+auto Transform(F f) {
+  auto make = [f](auto base) { return TransformView<decltype(base), F>(std::move(base), f); };
+  return Adaptor<decltype(make)>{make};
+}
+
+inline auto Take(std::size_t n) {
+  auto make = [n](auto base) { return TakeView<decltype(base)>(std::move(base), n); };
+  return Adaptor<decltype(make)>{make};
+}
+
+// A chunk size of zero would never move past the first chunk.
+inline auto Chunk(std::size_t n) {
+  if (n == 0) {
+    throw std::invalid_argument("Chunk: n must be positive");
+  }
+  auto make = [n](auto base) { return ChunkView<decltype(base)>(std::move(base), n); };
+  return Adaptor<decltype(make)>{make};
+}
+
+template <typename R1, typename R2>
+auto Zip(R1 &&first, R2 &&second) {
+  auto a = All(std::forward<R1>(first));
+  auto b = All(std::forward<R2>(second));
+  return ZipView<decltype(a), decltype(b)>(std::move(a), std::move(b));
+}
+
+template <typename R>
+auto ZipWith(R &&second) {
+  auto other = All(std::forward<R>(second));
+  auto make = [other](auto base) { return ZipView<decltype(base), decltype(other)>(std::move(base), other); };
+  return Adaptor<decltype(make)>{make};
+}
+
+/**
+ * ThreadPool keeps `threads - 1` workers; the thread calling RunTasks() is the
+ * last one and works alongside them until the batch is finished.
+ */
+class ThreadPool {
+ public:
+  explicit ThreadPool(std::size_t threads) {
+    for (std::size_t i = 1; i < threads; i++) {
+      m_workers_.emplace_back([this] {
+        for (;;) {
+          std::function<void()> job;
+          {
+            std::unique_lock<std::mutex> lock(m_mutex_);
+            m_cv_.wait(lock, [this] { return m_stop_ || !m_jobs_.empty(); });
+            if (m_jobs_.empty()) {
+              return;
+            }
+            job = std::move(m_jobs_.front());
+            m_jobs_.pop_front();
+          }
+          job();
+        }
+      });
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex_);
+      m_stop_ = true;
+    }
+    m_cv_.notify_all();
+    for (std::thread &worker : m_workers_) {
+      worker.join();
+    }
+  }
+
+  std::size_t size() const {
+    return m_workers_.size() + 1;
+  }
+
+  /**
+   * Calls task(0) ... task(count - 1), each exactly once, spread over the pool,
+   * and returns when all of them have finished. Tasks are handed out one index
+   * at a time, so uneven tasks still balance.
+   */
+  void RunTasks(std::size_t count, const std::function<void(std::size_t)> &task) {
+    std::atomic<std::size_t> next{0};
+    auto drain = [&next, count, &task] {
+      for (std::size_t i = next++; i < count; i = next++) {
+        task(i);
+      }
+    };
+    std::size_t helpers = std::min(m_workers_.size(), count > 0 ? count - 1 : 0);
+    std::size_t finished = 0;
+    std::mutex done_mutex;
+    std::condition_variable done_cv;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex_);
+      for (std::size_t i = 0; i < helpers; i++) {
+        m_jobs_.push_back([&] {
+          drain();
+          std::lock_guard<std::mutex> done_lock(done_mutex);
+          if (++finished == helpers) {
+            done_cv.notify_one();
+          }
+        });
+      }
+    }
+    m_cv_.notify_all();
+    drain();
+    std::unique_lock<std::mutex> lock(done_mutex);
+    done_cv.wait(lock, [&] { return finished == helpers; });
+  }
+
+ private:
+  std::vector<std::thread> m_workers_;
+  std::deque<std::function<void()>> m_jobs_;
+  std::mutex m_mutex_;
+  std::condition_variable m_cv_;
+  bool m_stop_ = false;
+};
+
+/**
+ * Number of chunks a range is cut into: a few per thread so that a slow chunk
+ * does not hold up the others, but none smaller than `grain` elements.
+ */
+template <typename It>
+std::size_t ChunkCount(const ThreadPool &pool, const SplitRange<It> &range, std::size_t grain) {
+  std::size_t by_grain = (range.size() + grain - 1) / std::max<std::size_t>(grain, 1);
+  return std::max<std::size_t>(1, std::min(pool.size() * 4, by_grain));
+}
+
+/**
+ * Calls f(element) for every element of the range. Within a chunk elements are
+ * visited in traversal order; chunks run concurrently.
+ */
+template <typename It, typename F>
+void ParallelForEach(ThreadPool &pool, const SplitRange<It> &range, F f, std::size_t grain = 1 << 14) {
+  std::vector<SplitRange<It>> chunks = range.Partition(ChunkCount(pool, range, grain));
+  pool.RunTasks(chunks.size(), [&chunks, &f](std::size_t i) { chunks[i].ForEach(f); });
+}
+
+/**
+ * Folds every chunk with fold(accumulator, element), starting from `identity`,
+ * then combines the partial results in traversal order. `combine` therefore
+ * only has to be associative, not commutative.
+ */
+template <typename It, typename T, typename Fold, typename Combine>
+T ParallelReduce(ThreadPool &pool, const SplitRange<It> &range, T identity, Fold fold, Combine combine,
+                 std::size_t grain = 1 << 14) {
+  std::vector<SplitRange<It>> chunks = range.Partition(ChunkCount(pool, range, grain));
+  std::vector<T> partials(chunks.size(), identity);
+  pool.RunTasks(chunks.size(), [&](std::size_t i) {
+    T acc = identity;
+    chunks[i].ForEach([&acc, &fold](auto &element) { acc = fold(acc, element); });
+    partials[i] = acc;
+  });
+  T result = identity;
+  for (const T &partial : partials) {
+    result = combine(result, partial);
+  }
+  return result;
+}
+
+/**
+ * Block kernels for batches of ints. Every kernel exists as a scalar loop and,
+ * on x86, as SSE4.1 and AVX2 versions compiled with per-function target
+ * attributes, so one binary runs on any x86-64 CPU and uses the widest
+ * instruction set it finds at startup. A general count_if cannot be
+ * vectorized, so the counting kernel is specialised to `element > threshold`.
+ */
+struct IntKernels {
+  const char *name;
+  std::int64_t (*sum)(std::span<const int>);
+  int (*min)(std::span<const int>);
+  int (*max)(std::span<const int>);
+  std::size_t (*count_greater)(std::span<const int>, int);
+};
+
+std::int64_t ScalarSum(std::span<const int> v) {
+  std::int64_t sum = 0;
+  for (int x : v) {
+    sum += x;
+  }
+  return sum;
+}
+
+int ScalarMin(std::span<const int> v) {
+  int result = std::numeric_limits<int>::max();
+  for (int x : v) {
+    result = std::min(result, x);
+  }
+  return result;
+}
+
+int ScalarMax(std::span<const int> v) {
+  int result = std::numeric_limits<int>::min();
+  for (int x : v) {
+    result = std::max(result, x);
+  }
+  return result;
+}
+
+std::size_t ScalarCountGreater(std::span<const int> v, int threshold) {
+  std::size_t count = 0;
+  for (int x : v) {
+    count += x > threshold;
+  }
+  return count;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("sse4.1"))) std::int64_t Sse41Sum(std::span<const int> v) {
+  __m128i acc = _mm_setzero_si128();
+  std::size_t i = 0;
+  for (; i + 4 <= v.size(); i += 4) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(v.data() + i));
+    acc = _mm_add_epi64(acc, _mm_cvtepi32_epi64(x));
+    acc = _mm_add_epi64(acc, _mm_cvtepi32_epi64(_mm_srli_si128(x, 8)));
+  }
+  alignas(16) std::int64_t lanes[2];
+  _mm_store_si128(reinterpret_cast<__m128i *>(lanes), acc);
+  return lanes[0] + lanes[1] + ScalarSum(v.subspan(i));
+}
+
+__attribute__((target("sse4.1"))) int Sse41Min(std::span<const int> v) {
+  __m128i acc = _mm_set1_epi32(std::numeric_limits<int>::max());
+  std::size_t i = 0;
+  for (; i + 4 <= v.size(); i += 4) {
+    acc = _mm_min_epi32(acc, _mm_loadu_si128(reinterpret_cast<const __m128i *>(v.data() + i)));
+  }
+  acc = _mm_min_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+  acc = _mm_min_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+  return std::min(_mm_cvtsi128_si32(acc), ScalarMin(v.subspan(i)));
+}
+
+__attribute__((target("sse4.1"))) int Sse41Max(std::span<const int> v) {
+  __m128i acc = _mm_set1_epi32(std::numeric_limits<int>::min());
+  std::size_t i = 0;
+  for (; i + 4 <= v.size(); i += 4) {
+    acc = _mm_max_epi32(acc, _mm_loadu_si128(reinterpret_cast<const __m128i *>(v.data() + i)));
+  }
+  acc = _mm_max_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+  acc = _mm_max_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+  return std::max(_mm_cvtsi128_si32(acc), ScalarMax(v.subspan(i)));
+}
+
+/**
+ * Each comparison yields -1 in the lanes that match, so subtracting the mask
+ * counts matches per lane. Lane counters are 32-bit, which limits one call to
+ * 2^32 elements per lane.
+ */
+__attribute__((target("sse4.1"))) std::size_t Sse41CountGreater(std::span<const int> v, int threshold) {
+  __m128i limit = _mm_set1_epi32(threshold);
+  __m128i counts = _mm_setzero_si128();
+  std::size_t i = 0;
+  for (; i + 4 <= v.size(); i += 4) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(v.data() + i));
+    counts = _mm_sub_epi32(counts, _mm_cmpgt_epi32(x, limit));
+  }
+  alignas(16) std::uint32_t lanes[4];
+  _mm_store_si128(reinterpret_cast<__m128i *>(lanes), counts);
+  std::size_t count = 0;
+  for (std::uint32_t lane : lanes) {
+    count += lane;
+  }
+  return count + ScalarCountGreater(v.subspan(i), threshold);
+}
+
+__attribute__((target("avx2"))) std::int64_t Avx2Sum(std::span<const int> v) {
+  __m256i acc0 = _mm256_setzero_si256();
+  __m256i acc1 = _mm256_setzero_si256();
+  std::size_t i = 0;
+  for (; i + 8 <= v.size(); i += 8) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(v.data() + i));
+    acc0 = _mm256_add_epi64(acc0, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(x)));
+    acc1 = _mm256_add_epi64(acc1, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(x, 1)));
+  }
+  __m256i acc = _mm256_add_epi64(acc0, acc1);
+  __m128i half = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+  alignas(16) std::int64_t lanes[2];
+  _mm_store_si128(reinterpret_cast<__m128i *>(lanes), half);
+  return lanes[0] + lanes[1] + ScalarSum(v.subspan(i));
+}
+
+__attribute__((target("avx2"))) int Avx2Min(std::span<const int> v) {
+  __m256i acc = _mm256_set1_epi32(std::numeric_limits<int>::max());
+  std::size_t i = 0;
+  for (; i + 8 <= v.size(); i += 8) {
+    acc = _mm256_min_epi32(acc, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(v.data() + i)));
+  }
+  __m128i half = _mm_min_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+  half = _mm_min_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+  half = _mm_min_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+  return std::min(_mm_cvtsi128_si32(half), ScalarMin(v.subspan(i)));
+}
+
+__attribute__((target("avx2"))) int Avx2Max(std::span<const int> v) {
+  __m256i acc = _mm256_set1_epi32(std::numeric_limits<int>::min());
+  std::size_t i = 0;
+  for (; i + 8 <= v.size(); i += 8) {
+    acc = _mm256_max_epi32(acc, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(v.data() + i)));
+  }
+  __m128i half = _mm_max_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+  half = _mm_max_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+  half = _mm_max_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+  return std::max(_mm_cvtsi128_si32(half), ScalarMax(v.subspan(i)));
+}
+
+__attribute__((target("avx2"))) std::size_t Avx2CountGreater(std::span<const int> v, int threshold) {
+  __m256i limit = _mm256_set1_epi32(threshold);
+  __m256i counts = _mm256_setzero_si256();
+  std::size_t i = 0;
+  for (; i + 8 <= v.size(); i += 8) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(v.data() + i));
+    counts = _mm256_sub_epi32(counts, _mm256_cmpgt_epi32(x, limit));
+  }
+  alignas(32) std::uint32_t lanes[8];
+  _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), counts);
+  std::size_t count = 0;
+  for (std::uint32_t lane : lanes) {
+    count += lane;
+  }
+  return count + ScalarCountGreater(v.subspan(i), threshold);
+}
+
+#endif
+
+/**
+ * Every kernel set this CPU can run, narrowest first.
+ */
+std::vector<const IntKernels *> SupportedKernels() {
+  static const IntKernels scalar{"scalar", ScalarSum, ScalarMin, ScalarMax, ScalarCountGreater};
+  std::vector<const IntKernels *> kernels{&scalar};
+#if defined(__x86_64__) || defined(__i386__)
+  static const IntKernels sse41{"sse4.1", Sse41Sum, Sse41Min, Sse41Max, Sse41CountGreater};
+  static const IntKernels avx2{"avx2", Avx2Sum, Avx2Min, Avx2Max, Avx2CountGreater};
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse4.1")) {
+    kernels.push_back(&sse41);
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    kernels.push_back(&avx2);
+  }
+#endif
+  return kernels;
+}
+
+/**
+ * The widest kernel set available, chosen once.
+ */
+const IntKernels &Kernels() {
+  static const IntKernels *best = SupportedKernels().back();
+  return *best;
+}
+
 /**
  * The client code may or may not know about the Concrete Iterator or Collection
  * classes, for this implementation the container is generic so you can used
@@ -112,9 +1481,662 @@ void ClientCode() {
   }
   delete it;
   delete it2;
+
+  std::cout << "________________Reverse iterator______________________________________" << std::endl;
+  Iterator<Data, Container<Data>> *it3 = cont2.CreateIterator(true);
+  for (it3->First(); !it3->IsDone(); it3->Next()) {
+    std::cout << it3->Current()->data() << std::endl;
+  }
+  delete it3;
+
+  std::cout << "________________Batches of 4 with " << Kernels().name << " kernels_______________________" << std::endl;
+  Iterator<int, Container<int>> *it4 = cont.CreateIterator();
+  for (std::span<int> batch = it4->NextBatch(4); !batch.empty(); batch = it4->NextBatch(4)) {
+    std::cout << "sum " << Kernels().sum(batch) << ", min " << Kernels().min(batch) << ", max "
+              << Kernels().max(batch) << ", > 4: " << Kernels().count_greater(batch, 4) << std::endl;
+  }
+  delete it4;
+
+  std::cout << "________________Struct of arrays________________________________________" << std::endl;
+  SoaContainer<Data> soa;
+  soa.Add(a);
+  soa.Add(b);
+  soa.Add(c);
+  soa[1] = Data(2000);
+  soa[2].get<0>() += 5;
+  for (int value : soa.Column<0>()) {
+    std::cout << value << " ";
+  }
+  for (Data record : soa) {
+    std::cout << "| " << record.data() << " ";
+  }
+  std::cout << std::endl;
+
+  std::cout << "________________Lazy adaptors__________________________________________" << std::endl;
+  Container<int> numbers;
+  for (int i = 1; i <= 12; i++) {
+    numbers.Add(i);
+  }
+  auto odd_squares = numbers | Filter([](int i) { return i % 2 == 1; }) | Transform([](int i) { return i * i; }) |
+                     Take(4);
+  for (int i : odd_squares) {
+    std::cout << i << " ";
+  }
+  std::cout << "| ";
+  for (auto [number, record] : Zip(numbers, cont2)) {
+    std::cout << number << ":" << record.data() << " ";
+  }
+  std::cout << "| ";
+  for (auto chunk : numbers | Chunk(5)) {
+    std::cout << "[";
+    for (int i : chunk) {
+      std::cout << " " << i;
+    }
+    std::cout << " ] ";
+  }
+  std::cout << std::endl;
+
+  std::cout << "________________Memory-mapped container__________________________________" << std::endl;
+  std::remove("iterator_demo.records");
+  {
+    MappedContainer<Data> file("iterator_demo.records", MappedContainer<Data>::Mode::kAppend);
+    for (Data record : cont2) {
+      file.Add(record);
+    }
+  }
+  {
+    MappedContainer<Data> file("iterator_demo.records", MappedContainer<Data>::Mode::kAppend);
+    file.Add(Data(100000));
+  }
+  MappedContainer<Data> file("iterator_demo.records");
+  for (const Data &record : file) {
+    std::cout << record.data() << " ";
+  }
+  std::cout << "(" << file.size() << " records)" << std::endl;
+  std::remove("iterator_demo.records");
+
+  std::cout << "________________Snapshot while a writer adds____________________________" << std::endl;
+  ConcurrentContainer<int> log;
+  for (int i = 0; i < 5; i++) {
+    log.Add(i);
+  }
+  ConcurrentContainer<int>::Snapshot before = log.snapshot();
+  std::thread writer([&log] {
+    for (int i = 5; i < 5000; i++) {
+      log.Add(i);
+    }
+  });
+  writer.join();
+  for (int i : before) {
+    std::cout << i << " ";
+  }
+  std::cout << "(snapshot of " << before.size() << ", container now " << log.size() << ")" << std::endl;
+}
+
+/**
+ * Times a parallel sum of `n` elements over 1, 2, 4, ... threads, up to the
+ * number of hardware threads (and at least 4).
+ */
+template <typename T, typename Value>
+void BenchmarkParallelReduce(const char *name, std::size_t n, Value value) {
+  using Clock = std::chrono::steady_clock;
+  Container<T> cont;
+  cont.Reserve(n);
+  for (std::size_t i = 0; i < n; i++) {
+    cont.Add(T(static_cast<int>(i & 0xFF)));
+  }
+  auto fold = [&value](std::int64_t acc, T &element) { return acc + value(element); };
+  auto plus = [](std::int64_t a, std::int64_t b) { return a + b; };
+
+  auto start = Clock::now();
+  std::int64_t expected = 0;
+  cont.Range().ForEach([&](T &element) { expected = fold(expected, element); });
+  double sequential_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  std::cout << "sum of " << n << " " << name << ": sequential " << sequential_ms << " ms\n";
+
+  std::size_t max_threads = std::max<std::size_t>(4, std::thread::hardware_concurrency());
+  for (std::size_t threads = 1; threads <= max_threads; threads *= 2) {
+    ThreadPool pool(threads);
+    start = Clock::now();
+    std::int64_t forward = ParallelReduce(pool, cont.Range(), std::int64_t{0}, fold, plus);
+    double forward_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    start = Clock::now();
+    std::int64_t backward = ParallelReduce(pool, cont.Range(true), std::int64_t{0}, fold, plus);
+    double backward_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::cout << "  " << threads << " threads: forward " << forward_ms << " ms (speedup "
+              << sequential_ms / forward_ms << "), reverse " << backward_ms << " ms"
+              << (forward == expected && backward == expected ? "" : " (MISMATCH)") << "\n";
+  }
 }
 
-int main() {
+/**
+ * The two summing loops are kept out of line so each is compiled the way client
+ * code receiving an iterator or a container would see it.
+ */
+__attribute__((noinline)) std::int64_t SumWithIterator(Iterator<int, Container<int>> *it) {
+  std::int64_t sum = 0;
+  for (it->First(); !it->IsDone(); it->Next()) {
+    sum += *it->Current();
+  }
+  return sum;
+}
+
+__attribute__((noinline)) std::int64_t SumWithRange(const Container<int> &cont) {
+  std::int64_t sum = 0;
+  for (int i : cont) {
+    sum += i;
+  }
+  return sum;
+}
+
+/**
+ * Cycle counter for the batch benchmark: the TSC on x86, nanoseconds elsewhere.
+ */
+std::uint64_t ReadCycleCounter() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+template <typename Acc, typename Step>
+__attribute__((noinline)) Acc FoldWithIterator(Iterator<int, Container<int>> *it, Acc acc, Step step) {
+  for (it->First(); !it->IsDone(); it->Next()) {
+    acc = step(acc, *it->Current());
+  }
+  return acc;
+}
+
+template <typename Acc, typename Kernel, typename Combine>
+__attribute__((noinline)) Acc FoldWithBatches(Iterator<int, Container<int>> *it, std::size_t batch, Acc acc,
+                                              Kernel kernel, Combine combine) {
+  it->First();
+  for (std::span<int> block = it->NextBatch(batch); !block.empty(); block = it->NextBatch(batch)) {
+    acc = combine(acc, kernel(block));
+  }
+  return acc;
+}
+
+/**
+ * Runs `fold` over the container `rounds` times and prints elements per cycle.
+ * The container is small enough to stay in cache, so the numbers measure the
+ * loop rather than memory bandwidth.
+ */
+template <typename Fold>
+std::int64_t ElementsPerCycle(const char *label, std::size_t elements, int rounds, Fold fold) {
+  std::int64_t check = 0;
+  std::uint64_t start = ReadCycleCounter();
+  for (int r = 0; r < rounds; r++) {
+    check += static_cast<std::int64_t>(fold());
+  }
+  std::uint64_t cycles = ReadCycleCounter() - start;
+  std::cout << "  " << label << static_cast<double>(elements) * rounds / static_cast<double>(cycles)
+            << " elements/cycle\n";
+  return check;
+}
+
+/**
+ * Compares sum/min/max/count-if through the per-element Iterator with
+ * NextBatch() plus every kernel set the CPU supports.
+ */
+void BenchmarkBatchKernels(std::size_t n, int rounds) {
+  Container<int> cont;
+  std::uint32_t seed = 12345;
+  for (std::size_t i = 0; i < n; i++) {
+    seed = seed * 1664525u + 1013904223u;
+    cont.Add(static_cast<int>(seed >> 8) - (1 << 23));
+  }
+  Iterator<int, Container<int>> *it = cont.CreateIterator();
+  std::vector<const IntKernels *> kernels = SupportedKernels();
+  const std::size_t batch = 4096;
+  const int threshold = 1 << 20;
+  auto plus = [](auto a, auto b) { return a + b; };
+  auto label = [](const IntKernels *k) { return (std::string(k->name) + ":         ").substr(0, 10); };
+  std::cout << n << " ints, " << rounds << " rounds, batches of " << batch << ", TSC cycles\n";
+
+  std::cout << "sum\n";
+  std::int64_t expected = ElementsPerCycle("iterator: ", n, rounds, [&] {
+    return FoldWithIterator(it, std::int64_t{0}, [](std::int64_t a, int x) { return a + x; });
+  });
+  for (const IntKernels *k : kernels) {
+    std::int64_t got = ElementsPerCycle(label(k).c_str(), n, rounds, [&] {
+      return FoldWithBatches(it, batch, std::int64_t{0}, k->sum, plus);
+    });
+    if (got != expected) {
+      std::cout << "  (MISMATCH)\n";
+    }
+  }
+
+  std::cout << "min\n";
+  auto min = [](int a, int b) { return std::min(a, b); };
+  expected = ElementsPerCycle("iterator: ", n, rounds, [&] {
+    return FoldWithIterator(it, std::numeric_limits<int>::max(), min);
+  });
+  for (const IntKernels *k : kernels) {
+    std::int64_t got = ElementsPerCycle(label(k).c_str(), n, rounds, [&] {
+      return FoldWithBatches(it, batch, std::numeric_limits<int>::max(), k->min, min);
+    });
+    if (got != expected) {
+      std::cout << "  (MISMATCH)\n";
+    }
+  }
+
+  std::cout << "max\n";
+  auto max = [](int a, int b) { return std::max(a, b); };
+  expected = ElementsPerCycle("iterator: ", n, rounds, [&] {
+    return FoldWithIterator(it, std::numeric_limits<int>::min(), max);
+  });
+  for (const IntKernels *k : kernels) {
+    std::int64_t got = ElementsPerCycle(label(k).c_str(), n, rounds, [&] {
+      return FoldWithBatches(it, batch, std::numeric_limits<int>::min(), k->max, max);
+    });
+    if (got != expected) {
+      std::cout << "  (MISMATCH)\n";
+    }
+  }
+
+  std::cout << "count_if(x > " << threshold << ")\n";
+  expected = ElementsPerCycle("iterator: ", n, rounds, [&] {
+    return FoldWithIterator(it, std::size_t{0}, [threshold](std::size_t a, int x) { return a + (x > threshold); });
+  });
+  for (const IntKernels *k : kernels) {
+    std::int64_t got = ElementsPerCycle(label(k).c_str(), n, rounds, [&] {
+      return FoldWithBatches(it, batch, std::size_t{0},
+                             [k, threshold](std::span<const int> b) { return k->count_greater(b, threshold); },
+                             plus);
+    });
+    if (got != expected) {
+      std::cout << "  (MISMATCH)\n";
+    }
+  }
+  delete it;
+}
+
+/**
+ * Runs a lazy pipeline and the equivalent hand-written loop over the same data
+ * and prints both times. `pipeline` and `loop` each return a checksum.
+ */
+template <typename Pipeline, typename Loop>
+void ComparePipeline(const char *name, Pipeline pipeline, Loop loop) {
+  using Clock = std::chrono::steady_clock;
+  auto start = Clock::now();
+  std::int64_t lazy = pipeline();
+  double lazy_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  start = Clock::now();
+  std::int64_t hand = loop();
+  double hand_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  std::cout << "  " << name << (lazy == hand ? "" : " (MISMATCH)") << ": adaptors " << lazy_ms
+            << " ms, hand-written " << hand_ms << " ms\n";
+}
+
+/**
+ * One writer appends ints while `readers` threads keep taking snapshots and
+ * summing them, all for `duration`. Returns appends per ms and elements the
+ * readers scanned per ms. The run is bounded by time rather than by a number of
+ * appends, because with a lock a writer can be starved for as long as readers
+ * keep overlapping.
+ */
+template <typename Append, typename Scan>
+std::pair<double, double> RunOneWriter(std::chrono::milliseconds duration, std::size_t readers, Append append,
+                                       Scan scan) {
+  using Clock = std::chrono::steady_clock;
+  std::atomic<bool> done{false};
+  std::atomic<std::size_t> scanned{0};
+  std::size_t appended = 0;
+  std::vector<std::thread> threads;
+  for (std::size_t r = 0; r < readers; r++) {
+    threads.emplace_back([&] {
+      std::size_t mine = 0;
+      while (!done.load(std::memory_order_relaxed)) {
+        mine += scan();
+      }
+      scanned += mine;
+    });
+  }
+  auto start = Clock::now();
+  threads.emplace_back([&] {
+    while (!done.load(std::memory_order_relaxed)) {
+      append(static_cast<int>(appended++ & 0xFF));
+    }
+  });
+  std::this_thread::sleep_for(duration);
+  done = true;
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  double elapsed_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  return {static_cast<double>(appended) / elapsed_ms, static_cast<double>(scanned.load()) / elapsed_ms};
+}
+
+/**
+ * ConcurrentContainer against a Container guarded by a shared_mutex, where a
+ * scanning reader holds the lock for the whole scan and the writer waits.
+ */
+void BenchmarkConcurrentAppend(std::chrono::milliseconds duration) {
+  std::cout << "one writer appending ints for " << duration.count() << " ms, readers scanning snapshots\n";
+  for (std::size_t readers : {0, 1, 2, 4}) {
+    ConcurrentContainer<int> concurrent;
+    auto concurrent_result = RunOneWriter(
+        duration, readers, [&](int v) { concurrent.Add(v); },
+        [&] {
+          ConcurrentContainer<int>::Snapshot snapshot = concurrent.snapshot();
+          std::int64_t sum = 0;
+          snapshot.ForEachSpan([&sum](std::span<const int> span) { sum += Kernels().sum(span); });
+          return snapshot.size() + (sum < 0);
+        });
+
+    Container<int> locked;
+    std::shared_mutex mutex;
+    auto locked_result = RunOneWriter(
+        duration, readers,
+        [&](int v) {
+          std::unique_lock<std::shared_mutex> lock(mutex);
+          locked.Add(v);
+        },
+        [&] {
+          std::shared_lock<std::shared_mutex> lock(mutex);
+          std::int64_t sum = Kernels().sum(std::span<const int>(locked.data(), locked.size()));
+          return locked.size() + (sum < 0);
+        });
+
+    std::cout << "  " << readers << " readers\n"
+              << "    ConcurrentContainer:        " << concurrent_result.first / 1000 << " M appends/s, "
+              << concurrent_result.second / 1000 << " M elements/s read\n"
+              << "    Container + shared_mutex:   " << locked_result.first / 1000 << " M appends/s, "
+              << locked_result.second / 1000 << " M elements/s read\n";
+  }
+}
+
+/**
+ * Lazy adaptor pipelines against the loops one would write by hand.
+ */
+void BenchmarkAdaptors(std::size_t n) {
+  Container<int> a;
+  Container<int> b;
+  a.Reserve(n);
+  b.Reserve(n);
+  std::uint32_t seed = 7;
+  for (std::size_t i = 0; i < n; i++) {
+    seed = seed * 1664525u + 1013904223u;
+    a.Add(static_cast<int>(seed >> 20));
+    b.Add(static_cast<int>(i & 0x3FF));
+  }
+  std::cout << "pipelines over " << n << " ints\n";
+
+  ComparePipeline(
+      "filter | transform | take",
+      [&] {
+        std::int64_t sum = 0;
+        for (std::int64_t x : a | Filter([](int i) { return i % 3 == 0; }) |
+                                  Transform([](int i) { return std::int64_t{i} * i; }) | Take(n / 4)) {
+          sum += x;
+        }
+        return sum;
+      },
+      [&] {
+        std::int64_t sum = 0;
+        std::size_t taken = 0;
+        for (int i : a) {
+          if (i % 3 == 0) {
+            if (taken++ == n / 4) {
+              break;
+            }
+            sum += std::int64_t{i} * i;
+          }
+        }
+        return sum;
+      });
+
+  ComparePipeline(
+      "zip | transform (dot product)",
+      [&] {
+        std::int64_t sum = 0;
+        for (std::int64_t x : Zip(a, b) | Transform([](auto p) { return std::int64_t{p.first} * p.second; })) {
+          sum += x;
+        }
+        return sum;
+      },
+      [&] {
+        std::int64_t sum = 0;
+        for (std::size_t i = 0; i < std::min(a.size(), b.size()); i++) {
+          sum += std::int64_t{a.data()[i]} * b.data()[i];
+        }
+        return sum;
+      });
+
+  ComparePipeline(
+      "chunk(64) | transform (largest chunk sum)",
+      [&] {
+        std::int64_t best = 0;
+        auto chunk_sum = [](auto chunk) {
+          std::int64_t sum = 0;
+          for (int i : chunk) {
+            sum += i;
+          }
+          return sum;
+        };
+        for (std::int64_t x : a | Chunk(64) | Transform(chunk_sum)) {
+          best = std::max(best, x);
+        }
+        return best;
+      },
+      [&] {
+        std::int64_t best = 0;
+        for (std::size_t start = 0; start < a.size(); start += 64) {
+          std::int64_t sum = 0;
+          for (std::size_t i = start; i < std::min(start + 64, a.size()); i++) {
+            sum += a.data()[i];
+          }
+          best = std::max(best, sum);
+        }
+        return best;
+      });
+}
+
+/**
+ * A ten-field sensor record, 72 bytes wide, for comparing storage layouts.
+ */
+struct Sample {
+  std::int64_t id;
+  std::int64_t timestamp;
+  double x, y, z;
+  double temperature;
+  double pressure;
+  double humidity;
+  std::int32_t sensor;
+  std::int32_t status;
+};
+
+template <>
+struct SoaTraits<Sample> {
+  typedef std::tuple<std::int64_t, std::int64_t, double, double, double, double, double, double, std::int32_t,
+                     std::int32_t>
+      Fields;
+
+  static Fields Split(const Sample &s) {
+    return Fields(s.id, s.timestamp, s.x, s.y, s.z, s.temperature, s.pressure, s.humidity, s.sensor, s.status);
+  }
+
+  static Sample Join(const Fields &f) {
+    auto [id, timestamp, x, y, z, temperature, pressure, humidity, sensor, status] = f;
+    return Sample{id, timestamp, x, y, z, temperature, pressure, humidity, sensor, status};
+  }
+};
+
+/**
+ * Sums the temperature field of `n` Samples stored as an array of structs
+ * (Container<Sample>) and as a structure of arrays (SoaContainer<Sample>),
+ * both through the column span and through whole-record proxy references.
+ */
+void BenchmarkSoa(std::size_t n) {
+  using Clock = std::chrono::steady_clock;
+  Container<Sample> aos;
+  SoaContainer<Sample> soa;
+  aos.Reserve(n);
+  soa.Reserve(n);
+  for (std::size_t i = 0; i < n; i++) {
+    auto v = static_cast<double>(i % 1000);
+    Sample sample{static_cast<std::int64_t>(i), static_cast<std::int64_t>(i) * 10, v, v, v,
+                  v * 0.5, 1000.0 + v, v / 10.0, static_cast<std::int32_t>(i % 64), 0};
+    aos.Add(sample);
+    soa.Add(sample);
+  }
+
+  auto start = Clock::now();
+  double aos_sum = 0;
+  for (const Sample &sample : aos) {
+    aos_sum += sample.temperature;
+  }
+  double aos_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+  start = Clock::now();
+  double column_sum = 0;
+  for (double temperature : soa.Column<5>()) {
+    column_sum += temperature;
+  }
+  double column_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+  start = Clock::now();
+  double proxy_sum = 0;
+  for (auto record : soa) {
+    proxy_sum += record.get<5>();
+  }
+  double proxy_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+  std::cout << "sum of one field over " << n << " " << sizeof(Sample) << "-byte records"
+            << (aos_sum == column_sum && aos_sum == proxy_sum ? "" : " (MISMATCH)") << "\n"
+            << "  array of structs:          " << aos_ms << " ms\n"
+            << "  SoA column span:           " << column_ms << " ms\n"
+            << "  SoA proxy reference get<>: " << proxy_ms << " ms\n";
+}
+
+/**
+ * Writes `n` Samples to `path` in append mode, then sums one field by reading
+ * the whole file into a buffer and by scanning the mapping. The file has just
+ * been written, so both runs read from the page cache.
+ */
+void BenchmarkMappedScan(std::size_t n, const std::string &path) {
+  using Clock = std::chrono::steady_clock;
+  std::remove(path.c_str());
+  auto start = Clock::now();
+  std::size_t header_bytes;
+  {
+    MappedContainer<Sample> file(path, MappedContainer<Sample>::Mode::kAppend);
+    header_bytes = file.header_bytes();
+    for (std::size_t i = 0; i < n; i++) {
+      auto v = static_cast<double>(i % 1000);
+      file.Add(Sample{static_cast<std::int64_t>(i), 0, v, v, v, v * 0.5, 0, 0, 0, 0});
+    }
+  }
+  double append_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  double gb = static_cast<double>(n * sizeof(Sample)) / 1e9;
+
+  // The buffer is left uninitialised so that the baseline pays for reading
+  // the file, not for zero-filling memory it is about to overwrite.
+  start = Clock::now();
+  std::unique_ptr<Sample[]> loaded = std::make_unique_for_overwrite<Sample[]>(n);
+  int fd = open(path.c_str(), O_RDONLY);
+  std::size_t done = 0;
+  char *out = reinterpret_cast<char *>(loaded.get());
+  while (done < n * sizeof(Sample)) {
+    ssize_t got = pread(fd, out + done, n * sizeof(Sample) - done,
+                        static_cast<off_t>(header_bytes + done));
+    if (got <= 0) {
+      break;
+    }
+    done += static_cast<std::size_t>(got);
+  }
+  close(fd);
+  double vector_sum = 0;
+  for (const Sample &sample : std::span<const Sample>(loaded.get(), n)) {
+    vector_sum += sample.temperature;
+  }
+  double vector_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  loaded.reset();
+
+  start = Clock::now();
+  double mapped_sum = 0;
+  {
+    MappedContainer<Sample> file(path);
+    for (const Sample &sample : file) {
+      mapped_sum += sample.temperature;
+    }
+  }
+  double mapped_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+  std::cout << "scan of a " << gb << " GB file of " << n << " records"
+            << (vector_sum == mapped_sum ? "" : " (MISMATCH)") << "\n"
+            << "  append mode write:      " << append_ms << " ms\n"
+            << "  read into buffer + sum: " << vector_ms << " ms, " << gb / vector_ms * 1000 << " GB/s\n"
+            << "  mapped streaming scan:  " << mapped_ms << " ms, " << gb / mapped_ms * 1000 << " GB/s\n";
+  std::remove(path.c_str());
+}
+
+/**
+ * Sums `n` ints once through the Iterator object and once through begin()/end().
+ */
+void BenchmarkSum(std::size_t n) {
+  using Clock = std::chrono::steady_clock;
+  Container<int> cont;
+  cont.Reserve(n);
+  for (std::size_t i = 0; i < n; i++) {
+    cont.Add(static_cast<int>(i & 0xFF));
+  }
+
+  Iterator<int, Container<int>> *it = cont.CreateIterator();
+  auto start = Clock::now();
+  std::int64_t iterator_sum = SumWithIterator(it);
+  double iterator_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  delete it;
+
+  start = Clock::now();
+  std::int64_t range_sum = SumWithRange(cont);
+  double range_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+  std::cout << "sum of " << n << " ints" << (iterator_sum == range_sum ? "" : " (MISMATCH)") << "\n"
+            << "  Iterator First/Next/IsDone/Current: " << iterator_ms << " ms\n"
+            << "  range-for over begin()/end():       " << range_ms << " ms\n";
+}
+
+int main(int argc, char *argv[]) {
   ClientCode();
+
+  std::cout << "________________Standard algorithms over begin()/end()__________________" << std::endl;
+  Container<int> cont;
+  for (int i = 0; i < 10; i++) {
+    cont.Add(i);
+  }
+  auto even = cont | std::views::filter([](int i) { return i % 2 == 0; });
+  for (int i : even) {
+    std::cout << i << " ";
+  }
+  std::cout << "sum " << std::accumulate(cont.begin(), cont.end(), 0) << std::endl;
+
+  std::cout << "________________Reverse range split into 3 chunks______________________" << std::endl;
+  for (const auto &chunk : cont.Range(true).Partition(3)) {
+    chunk.ForEach([](int i) { std::cout << i << " "; });
+    std::cout << "| ";
+  }
+  ThreadPool pool(4);
+  auto concat = [](std::string a, const std::string &b) { return a + b; };
+  std::cout << "\nparallel reduce, reverse: "
+            << ParallelReduce(
+                   pool, cont.Range(true), std::string(),
+                   [](std::string acc, int i) { return acc + std::to_string(i); }, concat, 2)
+            << std::endl;
+
+  if (argc > 1 && std::string(argv[1]) == "--bench") {
+    std::cout << std::endl;
+    BenchmarkSum(100000000);
+    std::cout << "hardware threads: " << std::thread::hardware_concurrency() << "\n";
+    BenchmarkParallelReduce<int>("ints", 50000000, [](int i) { return i; });
+    BenchmarkParallelReduce<Data>("Data", 50000000, [](Data &d) { return d.data(); });
+    BenchmarkBatchKernels(16384, 2000);
+    BenchmarkSoa(4000000);
+    BenchmarkAdaptors(20000000);
+    BenchmarkMappedScan(20000000, "iterator_bench.records");
+    BenchmarkConcurrentAppend(std::chrono::milliseconds(500));
+  }
   return 0;
 }
\ No newline at end of file
@@ -1,8 +1,378 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
 #include <iostream>
+#include <stdexcept>
 #include <string>
 #include <ctime>
 #include <vector>
 #include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * A fast non-cryptographic 64-bit hash (8 bytes per step, splitmix-style
+ * finalizer). Equal hashes are always confirmed by comparing the content.
+ */
+std::uint64_t MixHash(std::uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBull;
+    h ^= h >> 31;
+    return h;
+}
+
+std::uint64_t HashBytes(const char *data, std::size_t length) {
+    std::uint64_t h = 0x9E3779B97F4A7C15ull ^ length;
+    std::size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        h = MixHash(h ^ word);
+    }
+    std::uint64_t tail = 0;
+    std::memcpy(&tail, data + i, length - i);
+    return MixHash(h ^ tail);
+}
+
+/**
+ * PersistentText is an immutable, structurally shared text buffer. The text is
+ * cut into fixed-size chunks that hang off a shallow radix tree. Nodes are
+ * never modified after construction, so copying a PersistentText copies only
+ * the root pointer, and an edit copies just the touched chunks and the path
+ * from them to the root. Old versions stay valid as long as someone holds them.
+ *
+ * Every node also carries a hash of its content (a Merkle tree), maintained on
+ * the nodes an edit creates anyway, so hashing a whole version costs O(1).
+ */
+class PersistentText
+{
+public:
+    static const std::size_t kChunkSize = 256;
+    static const std::size_t kFanoutBits = 5;
+    static const std::size_t kFanout = std::size_t(1) << kFanoutBits;
+
+private:
+    struct Node {
+        std::string bytes;
+        std::vector<std::shared_ptr<const Node>> children;
+        std::uint64_t hash = 0;
+    };
+    using NodePtr = std::shared_ptr<const Node>;
+
+    NodePtr root_;
+    std::size_t size_ = 0;
+    std::size_t height_ = 0;
+
+    static void HashLeaf(Node &leaf) {
+        leaf.hash = HashBytes(leaf.bytes.data(), leaf.bytes.size());
+    }
+    static void HashChildren(Node &node) {
+        std::uint64_t h = node.children.size();
+        for (const NodePtr &child : node.children) {
+            h = MixHash(h ^ (child ? child->hash : 0));
+        }
+        node.hash = h;
+    }
+    static bool SameContent(const Node *a, const Node *b, std::size_t height) {
+        if (a == b) {
+            return true;
+        }
+        if (!a || !b || a->hash != b->hash) {
+            return false;
+        }
+        if (height == 0) {
+            return a->bytes == b->bytes;
+        }
+        if (a->children.size() != b->children.size()) {
+            return false;
+        }
+        for (std::size_t i = 0; i < a->children.size(); ++i) {
+            if (!SameContent(a->children[i].get(), b->children[i].get(), height - 1)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::size_t ChunkCapacity() const {
+        return std::size_t(1) << (kFanoutBits * this->height_);
+    }
+
+    const Node *FindChunk(std::size_t index) const {
+        const Node *node = this->root_.get();
+        for (std::size_t h = this->height_; node && h > 0; --h) {
+            std::size_t slot = (index >> (kFanoutBits * (h - 1))) & (kFanout - 1);
+            node = slot < node->children.size() ? node->children[slot].get() : nullptr;
+        }
+        return node;
+    }
+    /**
+     * Returns a copy of `node` in which chunk `index` is replaced by `leaf`.
+     * Only the nodes on the path are copied; every other subtree is shared.
+     */
+    static NodePtr SetChunk(const NodePtr &node, std::size_t height,
+                            std::size_t index, NodePtr leaf) {
+        if (height == 0) {
+            return leaf;
+        }
+        auto copy = node ? std::make_shared<Node>(*node) : std::make_shared<Node>();
+        std::size_t slot = (index >> (kFanoutBits * (height - 1))) & (kFanout - 1);
+        if (copy->children.size() <= slot) {
+            copy->children.resize(slot + 1);
+        }
+        copy->children[slot] = SetChunk(copy->children[slot], height - 1, index, std::move(leaf));
+        HashChildren(*copy);
+        return copy;
+    }
+
+    template <typename Visit>
+    static void VisitChunks(const Node *node, std::size_t height, Visit &visit) {
+        if (!node) {
+            return;
+        }
+        if (height == 0) {
+            visit(node->bytes);
+            return;
+        }
+        for (const NodePtr &child : node->children) {
+            VisitChunks(child.get(), height - 1, visit);
+        }
+    }
+
+public:
+    PersistentText() {}
+    PersistentText(const std::string &text) {
+        this->Assign(text);
+    }
+    /**
+     * Replaces the whole text. The tree is built bottom-up with the minimal
+     * height for the new size.
+     */
+    void Assign(const std::string &text) {
+        std::vector<NodePtr> level;
+        for (std::size_t pos = 0; pos < text.size(); pos += kChunkSize) {
+            auto leaf = std::make_shared<Node>();
+            leaf->bytes = text.substr(pos, kChunkSize);
+            HashLeaf(*leaf);
+            level.push_back(std::move(leaf));
+        }
+        this->height_ = 0;
+        while (level.size() > 1) {
+            std::vector<NodePtr> parents;
+            for (std::size_t i = 0; i < level.size(); i += kFanout) {
+                auto parent = std::make_shared<Node>();
+                std::size_t end = std::min(level.size(), i + kFanout);
+                parent->children.assign(level.begin() + i, level.begin() + end);
+                HashChildren(*parent);
+                parents.push_back(std::move(parent));
+            }
+            level.swap(parents);
+            ++this->height_;
+        }
+        this->root_ = level.empty() ? nullptr : level.front();
+        this->size_ = text.size();
+    }
+    /**
+     * Overwrites the text starting at `pos`, extending it if the new bytes run
+     * past the end. A `pos` beyond the end is treated as an append.
+     */
+    void Write(std::size_t pos, const std::string &text) {
+        pos = std::min(pos, this->size_);
+        std::size_t end = pos + text.size();
+        std::size_t first = pos / kChunkSize;
+        std::size_t last = (end + kChunkSize - 1) / kChunkSize;
+        while (last > this->ChunkCapacity()) {
+            if (this->root_) {
+                auto root = std::make_shared<Node>();
+                root->children.push_back(this->root_);
+                HashChildren(*root);
+                this->root_ = root;
+            }
+            ++this->height_;
+        }
+        for (std::size_t chunk = first; chunk < last; ++chunk) {
+            const Node *old = this->FindChunk(chunk);
+            auto leaf = std::make_shared<Node>();
+            if (old) {
+                leaf->bytes = old->bytes;
+            }
+            std::size_t chunk_begin = chunk * kChunkSize;
+            std::size_t from = std::max(pos, chunk_begin);
+            std::size_t to = std::min(end, chunk_begin + kChunkSize);
+            if (leaf->bytes.size() < to - chunk_begin) {
+                leaf->bytes.resize(to - chunk_begin);
+            }
+            leaf->bytes.replace(from - chunk_begin, to - from, text, from - pos, to - from);
+            HashLeaf(*leaf);
+            this->root_ = SetChunk(this->root_, this->height_, chunk, std::move(leaf));
+        }
+        this->size_ = std::max(this->size_, end);
+    }
+    void Append(const std::string &text) {
+        this->Write(this->size_, text);
+    }
+    std::size_t size() const {
+        return this->size_;
+    }
+    /**
+     * Content hash of the whole text. Equal texts always have equal hashes,
+     * because the tree shape depends only on the size.
+     */
+    std::uint64_t hash() const {
+        return MixHash((this->root_ ? this->root_->hash : 0) ^ this->size_);
+    }
+    /**
+     * Compares content, skipping every subtree the two versions share and
+     * bailing out at the first node whose hashes differ.
+     */
+    bool Equals(const PersistentText &other) const {
+        return this->size_ == other.size_ &&
+               SameContent(this->root_.get(), other.root_.get(), this->height_);
+    }
+    std::string Substr(std::size_t pos, std::size_t length) const {
+        std::string result;
+        std::size_t end = std::min(this->size_, pos + length);
+        while (pos < end) {
+            const Node *leaf = this->FindChunk(pos / kChunkSize);
+            std::size_t offset = pos % kChunkSize;
+            std::size_t count = std::min(end - pos, kChunkSize - offset);
+            result.append(leaf->bytes, offset, count);
+            pos += count;
+        }
+        return result;
+    }
+    std::string ToString() const {
+        std::string result;
+        result.reserve(this->size_);
+        auto append = [&result](const std::string &bytes) { result += bytes; };
+        VisitChunks(this->root_.get(), this->height_, append);
+        return result;
+    }
+    /**
+     * Calls `visit(const std::string &)` for every chunk in order, without
+     * flattening the text.
+     */
+    template <typename Visit>
+    void ForEachChunk(Visit visit) const {
+        VisitChunks(this->root_.get(), this->height_, visit);
+    }
+    friend std::ostream &operator<<(std::ostream &os, const PersistentText &text) {
+        if (!os) {
+            return os;
+        }
+        auto write = [&os](const std::string &bytes) { os << bytes; };
+        VisitChunks(text.root_.get(), text.height_, write);
+        return os;
+    }
+};
+
+/**
+ * Mementos are stamped with a monotonic clock so the history stays ordered even
+ * if the wall clock jumps. The wall-clock time is only reconstructed, through a
+ * fixed anchor pair, when a date has to be displayed.
+ */
+std::int64_t MonotonicNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::int64_t WallClockNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+struct ClockAnchor {
+    std::int64_t monotonic = MonotonicNanos();
+    std::int64_t wall = WallClockNanos();
+};
+
+const ClockAnchor &GetClockAnchor() {
+    static const ClockAnchor anchor;
+    return anchor;
+}
+
+std::int64_t MonotonicFromWallClock(std::int64_t wall) {
+    return GetClockAnchor().monotonic + (wall - GetClockAnchor().wall);
+}
+
+std::string FormatTimestamp(std::int64_t monotonic) {
+    std::int64_t wall = GetClockAnchor().wall + (monotonic - GetClockAnchor().monotonic);
+    std::time_t date = static_cast<std::time_t>(wall / 1000000000);
+    return std::ctime(&date);
+}
+
+/**
+ * ContentStore keeps one copy of every distinct state handed to it. Intern()
+ * looks the state up by its content hash and, if an equal payload is still
+ * alive, returns that instead of the new one, so identical mementos (autosave
+ * firing on an unchanged state, or a state returning to an earlier value)
+ * reference a single payload. The store holds payloads weakly: a payload dies
+ * with the last memento that references it.
+ */
+class ContentStore
+{
+public:
+    using Payload = std::shared_ptr<const PersistentText>;
+
+    struct Stats {
+        std::uint64_t backups = 0;
+        std::uint64_t unique = 0;
+        std::uint64_t logical_bytes = 0;
+        std::uint64_t stored_bytes = 0;
+        std::uint64_t intern_nanos = 0;
+    };
+
+private:
+    std::unordered_map<std::uint64_t, std::weak_ptr<const PersistentText>> payloads_;
+    std::size_t purge_at_ = 1024;
+    Stats stats_;
+
+    void PurgeExpired() {
+        for (auto it = this->payloads_.begin(); it != this->payloads_.end();) {
+            it = it->second.expired() ? this->payloads_.erase(it) : std::next(it);
+        }
+        this->purge_at_ = std::max<std::size_t>(1024, this->payloads_.size() * 2);
+    }
+
+public:
+    Payload Intern(const PersistentText &state) {
+        auto start = std::chrono::steady_clock::now();
+        ++this->stats_.backups;
+        this->stats_.logical_bytes += state.size();
+        std::weak_ptr<const PersistentText> &slot = this->payloads_[state.hash()];
+        Payload payload = slot.lock();
+        if (!payload || !payload->Equals(state)) {
+            // On a (rare) hash collision the newer payload takes over the slot.
+            payload = std::make_shared<const PersistentText>(state);
+            slot = payload;
+            ++this->stats_.unique;
+            this->stats_.stored_bytes += state.size();
+            if (this->payloads_.size() >= this->purge_at_) {
+                this->PurgeExpired();
+            }
+        }
+        this->stats_.intern_nanos += static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count());
+        return payload;
+    }
+    const Stats &stats() const {
+        return this->stats_;
+    }
+};
 
 /**
  * The Memento interface provides a way to retrieve the memento's metadata, such
@@ -13,40 +383,52 @@ class Memento
 public:
     virtual std::string GetName() const = 0;
     virtual std::string date() const = 0;
-    virtual std::string state() const = 0;
+    virtual std::int64_t timestamp() const = 0;
+    virtual std::uint64_t sequence() const = 0;
+    virtual PersistentText state() const = 0;
     virtual ~Memento() {}
 };
 
 /**
  * The Concrete Memento contains the infrastructure for storing the Originator's
- * state.
+ * state. Its metadata is just a monotonic timestamp (nanoseconds) and a
+ * sequence number; nothing is formatted until someone displays it. The state
+ * itself is a reference to a payload that may be shared with other mementos.
  */
 class ConcreteMemento : public Memento
 {
 private:
-    std::string state_;
-    std::string date_;
+    ContentStore::Payload state_;
+    std::int64_t timestamp_;
+    std::uint64_t sequence_;
 public:
-    ConcreteMemento(std::string state) 
-        : state_{state}
-        {
-            std::time_t now = std::time(0);
-            this->date_ = std::ctime(&now);
-        }
+    ConcreteMemento(ContentStore::Payload state, std::int64_t timestamp, std::uint64_t sequence)
+        : state_{std::move(state)}, timestamp_{timestamp}, sequence_{sequence}
+        {}
+    ConcreteMemento(PersistentText state, std::int64_t timestamp, std::uint64_t sequence)
+        : state_{std::make_shared<const PersistentText>(std::move(state))},
+          timestamp_{timestamp}, sequence_{sequence}
+        {}
       /**
    * The Originator uses this method when restoring its state.
    */
-    std::string state() const override {
-        return this->state_;
+    PersistentText state() const override {
+        return *this->state_;
     }
       /**
    * The rest of the methods are used by the Caretaker to display metadata.
    */
     std::string GetName() const override {
-        return this->date_ + " / (" + this->state_.substr(0, 9) + "...)";
+        return this->date() + " / (" + this->state_->Substr(0, 9) + "...)";
     }
     std::string date() const override {
-        return this->date_;
+        return FormatTimestamp(this->timestamp_);
+    }
+    std::int64_t timestamp() const override {
+        return this->timestamp_;
+    }
+    std::uint64_t sequence() const override {
+        return this->sequence_;
     }
     ~ConcreteMemento() {}
     
@@ -59,11 +441,13 @@ public:
 class Originator
 {
  /**
-   * @var string For the sake of simplicity, the originator's state is stored
-   * inside a single variable.
+   * @var PersistentText The originator's state is stored inside a single
+   * persistent buffer, so taking a snapshot of it never copies the text.
    */
 private:
-    std::string state_;
+    PersistentText state_;
+    std::uint64_t sequence_ = 0;
+    ContentStore store_;
 
     std::string GenerateRandomString(int length = 10) {
         const char alphanum[] = "0123456789"
@@ -91,15 +475,29 @@ public:
     ~Originator() {}
     void DoSomething() {
         std::cout << "Originator: I'm doing  something important.\n";
-        this->state_ = this->GenerateRandomString(30);
+        this->state_.Assign(this->GenerateRandomString(30));
         std::cout << "Originator: and my state has changed to: "
                   << this->state_ << "\n";
     }
       /**
-   * Saves the current state inside a memento.
+   * Patches a part of the state in place. Only the chunks covering
+   * [pos, pos + text.size()) are copied; earlier snapshots keep sharing the
+   * rest.
+   */
+    void Edit(std::size_t pos, const std::string &text) {
+        this->state_.Write(pos, text);
+    }
+      /**
+   * Saves the current state inside a memento. This only captures the root of
+   * the persistent buffer, so it costs O(1) regardless of the state size. A
+   * state equal to one an existing memento already holds is stored only once.
    */
     Memento *Save() {
-        return new ConcreteMemento(this->state_);
+        return new ConcreteMemento(this->store_.Intern(this->state_), MonotonicNanos(),
+                                   this->sequence_++);
+    }
+    const ContentStore &store() const {
+        return this->store_;
     }
       /**
    * Restores the Originator's state from a memento object.
@@ -111,6 +509,383 @@ public:
 
 };
 
+/**
+ * Standard CRC-32 (IEEE 802.3), used to detect torn or corrupted snapshots.
+ */
+std::uint32_t Crc32(const char *data, std::size_t length, std::uint32_t crc = 0) {
+    static const std::vector<std::uint32_t> table = [] {
+        std::vector<std::uint32_t> t(256);
+        for (std::uint32_t i = 0; i < 256; ++i) {
+            std::uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for (std::size_t i = 0; i < length; ++i) {
+        crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+/**
+ * SnapshotLog keeps the Caretaker's history on disk so it survives a restart.
+ *
+ * `<path>` holds an 8-byte magic followed by append-only segments, one per
+ * snapshot: a fixed header (magic, CRC-32 of the payload, payload length,
+ * timestamp) and the raw state bytes. `<path>.idx` holds one fixed-size entry
+ * per snapshot mapping its timestamp to the segment offset. Timestamps never
+ * go backwards in the log: one older than the last entry, as after the wall
+ * clock is stepped back, is recorded as the last entry's.
+ *
+ * Segments are written before their index entry, so a crash of the process
+ * can at worst lose the tail of the index, which is dropped on open if it
+ * points past the data. Nothing is synced to disk, so after a power failure
+ * the index may also name a segment that never reached it; Read() then fails
+ * its magic or checksum check.
+ *
+ * Opening the log reads only the small index; the data file is mmap-ed and a
+ * version is read (and its checksum verified) only when it is restored.
+ *
+ * All public methods are safe to call from several threads.
+ */
+class SnapshotLog
+{
+public:
+    struct IndexEntry {
+        std::int64_t timestamp;
+        std::uint64_t offset;
+    };
+
+private:
+    struct SegmentHeader {
+        std::uint32_t magic;
+        std::uint32_t crc;
+        std::uint64_t length;
+        std::int64_t timestamp;
+    };
+    static constexpr char kFileMagic[8] = {'M', 'E', 'M', 'S', 'N', 'A', 'P', '1'};
+    static const std::uint32_t kSegmentMagic = 0x4D474553;  // "SEGM"
+
+    int data_fd_ = -1;
+    int index_fd_ = -1;
+    std::uint64_t data_size_ = 0;
+    std::vector<IndexEntry> index_;
+    mutable const char *map_ = nullptr;
+    mutable std::uint64_t map_size_ = 0;
+    mutable std::mutex mutex_;
+
+    void Unmap() const {
+        if (this->map_) {
+            munmap(const_cast<char *>(this->map_), this->map_size_);
+            this->map_ = nullptr;
+            this->map_size_ = 0;
+        }
+    }
+    /**
+     * Segments appended after the last mapping are not visible through it, so
+     * the data file is remapped lazily when a read reaches past the mapping.
+     */
+    void EnsureMapped(std::uint64_t end) const {
+        if (end <= this->map_size_) {
+            return;
+        }
+        this->Unmap();
+        void *map = mmap(nullptr, this->data_size_, PROT_READ, MAP_SHARED, this->data_fd_, 0);
+        if (map == MAP_FAILED) {
+            throw std::runtime_error("SnapshotLog: mmap failed");
+        }
+        this->map_ = static_cast<const char *>(map);
+        this->map_size_ = this->data_size_;
+    }
+    static void WriteAll(int fd, const char *data, std::size_t length, std::uint64_t offset) {
+        while (length > 0) {
+            ssize_t written = pwrite(fd, data, length, static_cast<off_t>(offset));
+            if (written <= 0) {
+                throw std::runtime_error("SnapshotLog: write failed");
+            }
+            data += written;
+            length -= static_cast<std::size_t>(written);
+            offset += static_cast<std::uint64_t>(written);
+        }
+    }
+
+    /**
+     * Opens or creates both files. The data file's magic is checked before the
+     * index is touched, so opening the wrong file leaves no `.idx` behind.
+     */
+    void Open(const std::string &path) {
+        this->data_fd_ = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (this->data_fd_ < 0) {
+            throw std::runtime_error("SnapshotLog: cannot open " + path);
+        }
+        struct stat st;
+        if (fstat(this->data_fd_, &st) != 0) {
+            throw std::runtime_error("SnapshotLog: cannot stat " + path);
+        }
+        this->data_size_ = static_cast<std::uint64_t>(st.st_size);
+        if (this->data_size_ != 0) {
+            char magic[sizeof(kFileMagic)];
+            if (pread(this->data_fd_, magic, sizeof(magic), 0) != static_cast<ssize_t>(sizeof(magic)) ||
+                std::memcmp(magic, kFileMagic, sizeof(magic)) != 0) {
+                throw std::runtime_error("SnapshotLog: " + path + " is not a snapshot log of this version");
+            }
+        }
+        this->index_fd_ = open((path + ".idx").c_str(), O_RDWR | O_CREAT, 0644);
+        if (this->index_fd_ < 0) {
+            throw std::runtime_error("SnapshotLog: cannot open " + path + ".idx");
+        }
+        if (this->data_size_ == 0) {
+            WriteAll(this->data_fd_, kFileMagic, sizeof(kFileMagic), 0);
+            this->data_size_ = sizeof(kFileMagic);
+            if (ftruncate(this->index_fd_, 0) != 0) {
+                throw std::runtime_error("SnapshotLog: cannot reset index");
+            }
+        }
+
+        if (fstat(this->index_fd_, &st) != 0) {
+            throw std::runtime_error("SnapshotLog: cannot stat " + path + ".idx");
+        }
+        std::size_t entries = static_cast<std::size_t>(st.st_size) / sizeof(IndexEntry);
+        this->index_.resize(entries);
+        if (entries && pread(this->index_fd_, this->index_.data(), entries * sizeof(IndexEntry), 0) !=
+                           static_cast<ssize_t>(entries * sizeof(IndexEntry))) {
+            throw std::runtime_error("SnapshotLog: cannot read index");
+        }
+        while (!this->index_.empty() &&
+               this->index_.back().offset + sizeof(SegmentHeader) > this->data_size_) {
+            this->index_.pop_back();
+        }
+        if (ftruncate(this->index_fd_, static_cast<off_t>(this->index_.size() * sizeof(IndexEntry))) != 0) {
+            throw std::runtime_error("SnapshotLog: cannot trim index");
+        }
+    }
+
+public:
+    SnapshotLog(const std::string &path) {
+        try {
+            this->Open(path);
+        } catch (...) {
+            this->Close();
+            throw;
+        }
+    }
+    ~SnapshotLog() {
+        this->Close();
+    }
+    SnapshotLog(const SnapshotLog &) = delete;
+    SnapshotLog &operator=(const SnapshotLog &) = delete;
+
+    void Close() {
+        this->Unmap();
+        if (this->data_fd_ >= 0) {
+            close(this->data_fd_);
+        }
+        if (this->index_fd_ >= 0) {
+            close(this->index_fd_);
+        }
+        this->data_fd_ = this->index_fd_ = -1;
+    }
+    std::size_t size() const {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        return this->index_.size();
+    }
+    std::uint64_t bytes() const {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        return this->data_size_;
+    }
+    std::int64_t timestamp(std::size_t version) const {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        return this->index_.at(version).timestamp;
+    }
+    /**
+     * Appends one segment and its index entry. Returns the new version number.
+     * The state is flattened and checksummed before the lock is taken. A
+     * `timestamp` older than the last entry's is raised to it, so Find() can
+     * keep binary-searching the index.
+     */
+    std::size_t Append(const PersistentText &state, std::int64_t timestamp) {
+        std::string segment(sizeof(SegmentHeader), '\0');
+        segment.reserve(sizeof(SegmentHeader) + state.size());
+        state.ForEachChunk([&segment](const std::string &bytes) { segment += bytes; });
+        SegmentHeader header{kSegmentMagic,
+                             Crc32(segment.data() + sizeof(SegmentHeader), state.size()),
+                             state.size(), timestamp};
+        std::memcpy(&segment[0], &header, sizeof(header));
+
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        if (!this->index_.empty() && timestamp < this->index_.back().timestamp) {
+            header.timestamp = this->index_.back().timestamp;
+            std::memcpy(&segment[0], &header, sizeof(header));
+        }
+        IndexEntry entry{header.timestamp, this->data_size_};
+        WriteAll(this->data_fd_, segment.data(), segment.size(), this->data_size_);
+        this->data_size_ += segment.size();
+        WriteAll(this->index_fd_, reinterpret_cast<const char *>(&entry), sizeof(entry),
+                 this->index_.size() * sizeof(IndexEntry));
+        this->index_.push_back(entry);
+        return this->index_.size() - 1;
+    }
+    /**
+     * Returns the latest version taken at or before `timestamp`, or size() if
+     * there is none. Timestamps are appended in order, so this is a binary
+     * search over the index.
+     */
+    std::size_t Find(std::int64_t timestamp) const {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        auto it = std::upper_bound(this->index_.begin(), this->index_.end(), timestamp,
+                                   [](std::int64_t t, const IndexEntry &e) { return t < e.timestamp; });
+        return it == this->index_.begin() ? this->index_.size() : static_cast<std::size_t>(it - this->index_.begin()) - 1;
+    }
+    /**
+     * Reads one version straight from the mapping. Throws if the segment is
+     * truncated or its checksum doesn't match.
+     */
+    PersistentText Read(std::size_t version) const {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        std::uint64_t offset = this->index_.at(version).offset;
+        this->EnsureMapped(offset + sizeof(SegmentHeader));
+        SegmentHeader header;
+        std::memcpy(&header, this->map_ + offset, sizeof(header));
+        if (header.magic != kSegmentMagic ||
+            offset + sizeof(header) + header.length > this->data_size_) {
+            throw std::runtime_error("SnapshotLog: truncated segment");
+        }
+        this->EnsureMapped(offset + sizeof(header) + header.length);
+        const char *payload = this->map_ + offset + sizeof(header);
+        if (Crc32(payload, header.length) != header.crc) {
+            throw std::runtime_error("SnapshotLog: checksum mismatch");
+        }
+        return PersistentText(std::string(payload, header.length));
+    }
+    Memento *Load(std::size_t version) const {
+        return new ConcreteMemento(this->Read(version),
+                                   MonotonicFromWallClock(this->timestamp(version)), version);
+    }
+};
+
+
+/**
+ * SnapshotWriter moves the expensive part of a backup off the caller's thread.
+ * The caller hands over a PersistentText, which is an immutable snapshot that
+ * costs one pointer copy; a background thread flattens, checksums and appends
+ * it to the SnapshotLog. The backlog is a fixed ring of `capacity` slots: when
+ * it is full, Submit() blocks until the writer catches up (backpressure) and
+ * the stall is counted. If appending fails, the writer keeps the first error
+ * and the next Submit() or Flush() rethrows it on the caller's thread.
+ */
+class SnapshotWriter
+{
+private:
+    struct Job {
+        PersistentText state;
+        std::int64_t timestamp;
+    };
+    SnapshotLog *log_;
+    std::vector<Job> ring_;
+    std::size_t head_ = 0;
+    std::size_t count_ = 0;
+    std::size_t stalls_ = 0;
+    bool writing_ = false;
+    bool stop_ = false;
+    std::exception_ptr error_;
+    std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    std::thread thread_;
+
+    void Run() {
+        std::unique_lock<std::mutex> lock(this->mutex_);
+        for (;;) {
+            this->not_empty_.wait(lock, [this] { return this->count_ || this->stop_; });
+            if (!this->count_) {
+                return;
+            }
+            Job job = std::move(this->ring_[this->head_]);
+            this->ring_[this->head_] = Job();
+            this->head_ = (this->head_ + 1) % this->ring_.size();
+            --this->count_;
+            this->writing_ = true;
+            this->not_full_.notify_all();
+            lock.unlock();
+            std::exception_ptr error;
+            try {
+                this->log_->Append(job.state, job.timestamp);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            job = Job();
+            lock.lock();
+            if (error && !this->error_) {
+                this->error_ = error;
+            }
+            this->writing_ = false;
+            this->not_full_.notify_all();
+        }
+    }
+
+    /**
+     * Called with the lock held. The error is cleared once reported.
+     */
+    void RethrowError() {
+        if (this->error_) {
+            std::exception_ptr error = this->error_;
+            this->error_ = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+
+public:
+    SnapshotWriter(SnapshotLog *log, std::size_t capacity)
+        : log_{log}, ring_(std::max<std::size_t>(capacity, 1))
+        {
+            this->thread_ = std::thread(&SnapshotWriter::Run, this);
+        }
+    /**
+     * Pending snapshots are still written before the thread exits.
+     */
+    ~SnapshotWriter() {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex_);
+            this->stop_ = true;
+        }
+        this->not_empty_.notify_one();
+        this->thread_.join();
+    }
+    SnapshotWriter(const SnapshotWriter &) = delete;
+    SnapshotWriter &operator=(const SnapshotWriter &) = delete;
+
+    void Submit(PersistentText state, std::int64_t timestamp) {
+        std::unique_lock<std::mutex> lock(this->mutex_);
+        this->RethrowError();
+        if (this->count_ == this->ring_.size()) {
+            ++this->stalls_;
+            this->not_full_.wait(lock, [this] { return this->count_ < this->ring_.size(); });
+        }
+        Job &slot = this->ring_[(this->head_ + this->count_) % this->ring_.size()];
+        slot.state = std::move(state);
+        slot.timestamp = timestamp;
+        ++this->count_;
+        lock.unlock();
+        this->not_empty_.notify_one();
+    }
+    /**
+     * Blocks until everything submitted so far is in the log.
+     */
+    void Flush() {
+        std::unique_lock<std::mutex> lock(this->mutex_);
+        this->not_full_.wait(lock, [this] { return !this->count_ && !this->writing_; });
+        this->RethrowError();
+    }
+    std::size_t stalls() {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        return this->stalls_;
+    }
+};
+
 /**
  * The Caretaker doesn't depend on the Concrete Memento class. Therefore, it
  * doesn't have access to the originator's state, stored inside the memento. It
@@ -123,18 +898,73 @@ class Caretaker
    */
 private:
     std::vector<Memento *> mementos_;
+    std::vector<std::int64_t> timestamps_;
     Originator *originator_;
+    SnapshotLog *log_ = nullptr;
+    std::unique_ptr<SnapshotWriter> writer_;
 public:
     Caretaker(Originator *originator)
         : originator_ {originator}
         {}
     ~Caretaker() {
-        delete originator_;
+        this->writer_.reset();
+        for (Memento *memento : this->mementos_) {
+            delete memento;
+        }
     }
     
+    /**
+     * Once a log is attached, every backup is also appended to it, so the
+     * history can be restored after a restart. The log must outlive the
+     * Caretaker.
+     */
+    void AttachLog(SnapshotLog *log) {
+        this->writer_.reset();
+        this->log_ = log;
+    }
+    /**
+     * In async mode Backup() only captures the snapshot and queues it; the
+     * log is written by a background SnapshotWriter with at most `backlog`
+     * snapshots in flight. A log has to be attached first.
+     */
+    void EnableAsyncBackup(std::size_t backlog) {
+        if (!this->log_) {
+            throw std::runtime_error("Caretaker: attach a log before enabling async backup");
+        }
+        this->writer_.reset(new SnapshotWriter(this->log_, backlog));
+    }
+    SnapshotWriter *writer() const {
+        return this->writer_.get();
+    }
     void Backup() {
         std::cout << "\nCaretaker: Saving Originator's state...\n";
         this->mementos_.push_back(this->originator_->Save());
+        this->timestamps_.push_back(this->mementos_.back()->timestamp());
+        if (this->writer_) {
+            this->writer_->Submit(this->mementos_.back()->state(), WallClockNanos());
+        } else if (this->log_) {
+            this->log_->Append(this->mementos_.back()->state(), WallClockNanos());
+        }
+    }
+    /**
+     * Restores the latest logged version taken at or before `timestamp`
+     * (nanoseconds since the epoch). Returns false if there is none.
+     */
+    bool RestoreFromLog(std::int64_t timestamp) {
+        if (!this->log_) {
+            return false;
+        }
+        if (this->writer_) {
+            this->writer_->Flush();
+        }
+        std::size_t version = this->log_->Find(timestamp);
+        if (version == this->log_->size()) {
+            return false;
+        }
+        std::unique_ptr<Memento> memento(this->log_->Load(version));
+        std::cout << "Caretaker: Restoring state from log: " << memento->GetName() << '\n';
+        this->originator_->Restore(memento.get());
+        return true;
     }
     void Undo() {
         if (!this->mementos_.size()) {
@@ -142,12 +972,35 @@ public:
         }
         Memento *memento = this->mementos_.back();
         this->mementos_.pop_back();
+        this->timestamps_.pop_back();
         std::cout << "Carataker: Restoring state to: " << memento->GetName() << '\n';
         try {
             this->originator_->Restore(memento);
         } catch (...) {
+            delete memento;
             this->Undo();
+            return;
         }
+        delete memento;
+    }
+    /**
+     * Restores the latest memento taken at or before `timestamp` (see
+     * MonotonicNanos()) without dropping the newer ones. Mementos are appended
+     * in timestamp order, so this is a binary search over a flat array of
+     * timestamps. Returns false if every memento is newer.
+     */
+    bool RestoreAt(std::int64_t timestamp) {
+        auto it = std::upper_bound(this->timestamps_.begin(), this->timestamps_.end(), timestamp);
+        if (it == this->timestamps_.begin()) {
+            return false;
+        }
+        Memento *memento = this->mementos_[static_cast<std::size_t>(it - this->timestamps_.begin()) - 1];
+        std::cout << "Caretaker: Restoring state as of: " << memento->GetName() << '\n';
+        this->originator_->Restore(memento);
+        return true;
+    }
+    std::size_t size() const {
+        return this->mementos_.size();
     }
 };
 
@@ -171,11 +1024,292 @@ void ClientCode() {
     std::cout << "\nClient: Once more!\n\n";
     caretaker->Undo();
 
+    std::int64_t checkpoint = MonotonicNanos();
+    originator->DoSomething();
+    caretaker->Backup();
+    std::cout << "\nClient: Go back to the latest backup taken before that change.\n\n";
+    caretaker->RestoreAt(checkpoint);
+
+}
+
+/**
+ * The history outlives the process when the Caretaker writes it to a
+ * SnapshotLog: a fresh Caretaker can pick up any logged version.
+ */
+void ClientCodeWithLog(const std::string &path) {
+    std::remove(path.c_str());
+    std::remove((path + ".idx").c_str());
+    std::int64_t before_second_change = 0;
+    {
+        SnapshotLog log(path);
+        Originator originator("Super-duper-super-puper-super.");
+        Caretaker caretaker(&originator);
+        caretaker.AttachLog(&log);
+        caretaker.EnableAsyncBackup(8);
+        caretaker.Backup();
+        originator.DoSomething();
+        caretaker.Backup();
+        before_second_change = WallClockNanos();
+        originator.DoSomething();
+        caretaker.Backup();
+    }
+    std::cout << "\nClient: The process restarts...\n\n";
+    SnapshotLog log(path);
+    Originator originator("Empty.");
+    Caretaker caretaker(&originator);
+    caretaker.AttachLog(&log);
+    caretaker.RestoreFromLog(before_second_change);
+}
+
+/**
+ * Benchmarks Backup/Undo over a large state that is patched after every backup,
+ * against the flat string state the Originator used to keep (every snapshot is
+ * a full copy). Console output of the Caretaker and Originator is muted while
+ * the clock runs.
+ */
+void BenchmarkBackupUndo(std::size_t state_size, int edits) {
+    using Clock = std::chrono::steady_clock;
+    std::string initial(state_size, 'x');
+    std::vector<std::size_t> positions;
+    for (int i = 0; i < edits; ++i) {
+        positions.push_back(static_cast<std::size_t>(std::rand()) % (state_size - 16));
+    }
+    const std::string patch = "0123456789ABCDEF";
+
+    std::cout.setstate(std::ios_base::badbit);
+    auto start = Clock::now();
+    {
+        std::vector<std::string> history;
+        std::string state = initial;
+        for (std::size_t pos : positions) {
+            history.push_back(state);
+            state.replace(pos, patch.size(), patch);
+        }
+        while (!history.empty()) {
+            state = history.back();
+            history.pop_back();
+        }
+    }
+    double flat_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    start = Clock::now();
+    {
+        Originator originator(initial);
+        Caretaker caretaker(&originator);
+        for (std::size_t pos : positions) {
+            caretaker.Backup();
+            originator.Edit(pos, patch);
+        }
+        for (int i = 0; i < edits; ++i) {
+            caretaker.Undo();
+        }
+    }
+    double persistent_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::cout.clear();
+
+    std::cout << "state " << state_size << " bytes, " << edits << " backup+edit, then undo all\n"
+              << "  flat string:     " << flat_ms << " ms ("
+              << edits / flat_ms * 1000.0 << " backup+undo/s)\n"
+              << "  persistent text: " << persistent_ms << " ms ("
+              << edits / persistent_ms * 1000.0 << " backup+undo/s)\n";
 }
 
-int main()
+/**
+ * Writes a history of `history_bytes` made of `snapshot_bytes` versions, drops
+ * it from the page cache, and measures how long a restarted process needs to
+ * restore one version from the middle of it. Reading the whole history back is
+ * timed for comparison.
+ */
+void BenchmarkLogRestore(const std::string &path, std::uint64_t history_bytes,
+                         std::size_t snapshot_bytes) {
+    using Clock = std::chrono::steady_clock;
+    std::remove(path.c_str());
+    std::remove((path + ".idx").c_str());
+    std::int64_t middle = 0;
+    std::size_t versions = static_cast<std::size_t>(history_bytes / snapshot_bytes);
+    {
+        SnapshotLog log(path);
+        PersistentText state(std::string(snapshot_bytes, 'x'));
+        for (std::size_t i = 0; i < versions; ++i) {
+            state.Write(static_cast<std::size_t>(std::rand()) % snapshot_bytes, "edit");
+            log.Append(state, static_cast<std::int64_t>(i));
+        }
+        middle = static_cast<std::int64_t>(versions / 2);
+    }
+    auto evict = [&path] {
+        int fd = open(path.c_str(), O_RDONLY);
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    };
+
+    evict();
+    std::cout.setstate(std::ios_base::badbit);
+    auto start = Clock::now();
+    {
+        Originator originator("Empty.");
+        Caretaker caretaker(&originator);
+        SnapshotLog log(path);
+        caretaker.AttachLog(&log);
+        caretaker.RestoreFromLog(middle);
+    }
+    double restore_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::cout.clear();
+
+    evict();
+    start = Clock::now();
+    std::uint64_t total = 0;
+    {
+        std::vector<char> buffer(1 << 20);
+        int fd = open(path.c_str(), O_RDONLY);
+        ssize_t n;
+        while ((n = read(fd, buffer.data(), buffer.size())) > 0) {
+            total += static_cast<std::uint64_t>(n);
+        }
+        close(fd);
+    }
+    double scan_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    std::cout << "history " << (total >> 20) << " MiB in " << versions << " versions of "
+              << snapshot_bytes << " bytes (cold cache)\n"
+              << "  time to first restore (open + find + verify + restore): " << restore_ms << " ms\n"
+              << "  reading the whole history:                              " << scan_ms << " ms\n";
+    std::remove(path.c_str());
+    std::remove((path + ".idx").c_str());
+}
+
+/**
+ * Measures the caller-side latency of each Backup() with a log attached,
+ * writing synchronously and through the background SnapshotWriter. Between
+ * backups the client patches the state and does `gap_us` of other work.
+ */
+void BenchmarkBackupLatency(const std::string &path, std::size_t state_size, int backups,
+                            int gap_us) {
+    using Clock = std::chrono::steady_clock;
+    auto run = [&](bool async, std::size_t &stalls) {
+        std::remove(path.c_str());
+        std::remove((path + ".idx").c_str());
+        std::vector<double> latencies;
+        SnapshotLog log(path);
+        Originator originator(std::string(state_size, 'x'));
+        Caretaker caretaker(&originator);
+        caretaker.AttachLog(&log);
+        if (async) {
+            caretaker.EnableAsyncBackup(64);
+        }
+        for (int i = 0; i < backups; ++i) {
+            originator.Edit(static_cast<std::size_t>(std::rand()) % state_size, "edit");
+            auto start = Clock::now();
+            caretaker.Backup();
+            latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+            auto until = Clock::now() + std::chrono::microseconds(gap_us);
+            while (Clock::now() < until) {
+            }
+        }
+        stalls = async ? caretaker.writer()->stalls() : 0;
+        std::sort(latencies.begin(), latencies.end());
+        return latencies;
+    };
+    std::cout.setstate(std::ios_base::badbit);
+    std::size_t sync_stalls = 0, async_stalls = 0;
+    std::vector<double> sync = run(false, sync_stalls);
+    std::vector<double> async = run(true, async_stalls);
+    std::cout.clear();
+    auto percentile = [](const std::vector<double> &v, double p) {
+        return v[static_cast<std::size_t>(p * (v.size() - 1))];
+    };
+    std::cout << "Backup() caller latency, " << state_size << "-byte state, " << backups
+              << " backups, " << gap_us << " us apart\n"
+              << "  sync log:  p50 " << percentile(sync, 0.5) << " us, p99 "
+              << percentile(sync, 0.99) << " us\n"
+              << "  async log: p50 " << percentile(async, 0.5) << " us, p99 "
+              << percentile(async, 0.99) << " us, " << async_stalls << " backpressure stalls\n";
+    std::remove(path.c_str());
+    std::remove((path + ".idx").c_str());
+}
+
+/**
+ * Fills the history with `versions` backups and compares point-in-time
+ * restores by binary search against walking back with Undo().
+ */
+void BenchmarkRestoreAt(std::size_t versions, int queries) {
+    using Clock = std::chrono::steady_clock;
+    std::cout.setstate(std::ios_base::badbit);
+    Originator originator("Version 0.");
+    Caretaker caretaker(&originator);
+    std::vector<std::int64_t> stamps;
+    for (std::size_t i = 0; i < versions; ++i) {
+        originator.Edit(0, std::to_string(i));
+        caretaker.Backup();
+        stamps.push_back(MonotonicNanos());
+    }
+    auto start = Clock::now();
+    for (int i = 0; i < queries; ++i) {
+        caretaker.RestoreAt(stamps[static_cast<std::size_t>(std::rand()) % versions]);
+    }
+    double search_us = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / queries;
+
+    start = Clock::now();
+    std::int64_t target = stamps[versions / 2];
+    while (caretaker.size() && stamps[caretaker.size() - 1] > target) {
+        caretaker.Undo();
+    }
+    double undo_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::cout.clear();
+    std::cout << versions << " versions, " << sizeof(ConcreteMemento) << " bytes per memento\n"
+              << "  RestoreAt (binary search): " << search_us << " us per restore\n"
+              << "  Undo back to the middle:   " << undo_ms << " ms\n";
+}
+
+/**
+ * Simulates a timer-driven autosave: most backups see an unchanged state, and
+ * every edit is eventually reverted, so the state keeps returning to earlier
+ * values. Reports how many logical payload bytes ended up stored once, and
+ * what interning costs per backup.
+ */
+void BenchmarkDeduplication(std::size_t state_size, int backups) {
+    std::cout.setstate(std::ios_base::badbit);
+    Originator originator(std::string(state_size, 'x'));
+    Caretaker caretaker(&originator);
+    std::size_t edited = 0;
+    for (int i = 0; i < backups; ++i) {
+        switch (std::rand() % 10) {
+        case 0:
+            edited = static_cast<std::size_t>(std::rand()) % (state_size - 4);
+            originator.Edit(edited, "edit");
+            break;
+        case 1:
+            originator.Edit(edited, "xxxx");
+            break;
+        }
+        caretaker.Backup();
+    }
+    std::cout.clear();
+    const ContentStore::Stats &stats = originator.store().stats();
+    std::cout << backups << " autosaves of a " << state_size << "-byte state\n"
+              << "  unique payloads: " << stats.unique << ", deduplication ratio "
+              << static_cast<double>(stats.logical_bytes) / static_cast<double>(stats.stored_bytes) << ":1\n"
+              << "  hash lookup + verify: "
+              << static_cast<double>(stats.intern_nanos) / static_cast<double>(stats.backups)
+              << " ns per backup\n";
+}
+
+int main(int argc, char *argv[])
 {
     std::srand(static_cast<unsigned int>(std::time(NULL)));
     ClientCode();
+    std::cout << "\n";
+    ClientCodeWithLog("memento_demo.log");
+    std::remove("memento_demo.log");
+    std::remove("memento_demo.log.idx");
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        std::uint64_t history_mib = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1024;
+        std::cout << "\n";
+        BenchmarkBackupUndo(1 << 20, 2000);
+        BenchmarkLogRestore("memento_bench.log", history_mib << 20, 1 << 20);
+        BenchmarkBackupLatency("memento_bench.log", 64 << 10, 5000, 1000);
+        BenchmarkRestoreAt(2000000, 1000);
+        BenchmarkDeduplication(1 << 20, 100000);
+    }
     return 0;
 }
\ No newline at end of file
@@ -1,5 +1,34 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <future>
 #include <iostream>
+#include <list>
 #include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
 /**
  * The Subject interface declares common operations for both RealSubject and the
  * Proxy. As long as the client works with RealSubject using this interface,
@@ -73,13 +102,1791 @@ public:
     
 };
 
+/**
+ * A keyed request/response form of Subject, for subjects whose answers depend
+ * on what is asked and are therefore worth caching.
+ */
+class KeyedSubject
+{
+public:
+    virtual std::string Request(const std::string &key) const = 0;
+    /**
+   * Answers several keys at once, in order. Subjects that can serve a batch in
+   * one round trip should override this; the default just asks one by one.
+   */
+    virtual std::vector<std::string> RequestBatch(const std::vector<std::string> &keys) const {
+        std::vector<std::string> values;
+        values.reserve(keys.size());
+        for (const std::string &key : keys) {
+            values.push_back(this->Request(key));
+        }
+        return values;
+    }
+    virtual ~KeyedSubject() {}
+};
+
+/**
+ * A deliberately slow stand-in for a remote service: every request waits for
+ * `latency` before answering with a `value_size`-byte value. By default it
+ * busy-waits, for precise timing; kSleep blocks instead, which is how a thread
+ * waiting on a network reply behaves and leaves the CPU to other callers. A
+ * batch costs the same single wait, like one round trip carrying many keys.
+ */
+class SlowSubject : public KeyedSubject
+{
+public:
+    enum Wait { kSpin, kSleep };
+
+private:
+    std::chrono::nanoseconds latency_;
+    std::size_t value_size_;
+    Wait wait_;
+    mutable std::atomic<std::uint64_t> calls_{0};
+
+    void Delay() const {
+        if (this->wait_ == kSleep) {
+            std::this_thread::sleep_for(this->latency_);
+        } else {
+            auto until = std::chrono::steady_clock::now() + this->latency_;
+            while (std::chrono::steady_clock::now() < until) {
+            }
+        }
+        this->calls_.fetch_add(1, std::memory_order_relaxed);
+    }
+    std::string ValueOf(const std::string &key) const {
+        std::string value = "value of " + key;
+        value.resize(std::max(value.size(), this->value_size_), '.');
+        return value;
+    }
+
+public:
+    SlowSubject(std::chrono::nanoseconds latency, std::size_t value_size = 64, Wait wait = kSpin)
+        : latency_{latency}, value_size_{value_size}, wait_{wait}
+        {}
+    std::string Request(const std::string &key) const override {
+        this->Delay();
+        return this->ValueOf(key);
+    }
+    std::vector<std::string> RequestBatch(const std::vector<std::string> &keys) const override {
+        this->Delay();
+        std::vector<std::string> values;
+        values.reserve(keys.size());
+        for (const std::string &key : keys) {
+            values.push_back(this->ValueOf(key));
+        }
+        return values;
+    }
+    std::uint64_t calls() const {
+        return this->calls_.load(std::memory_order_relaxed);
+    }
+};
+
+/**
+ * CachingProxy answers repeated requests from memory. The cache is split into
+ * shards by key hash, each with its own lock and LRU list, so threads asking
+ * for different keys rarely contend. Every entry expires `ttl` after it was
+ * fetched, and each shard evicts from the cold end of its list once its share
+ * of `budget_bytes` is used up. The real subject is called outside the shard
+ * lock, so a slow miss never holds up hits on the same shard.
+ */
+class CachingProxy : public KeyedSubject
+{
+public:
+    struct Stats {
+        std::uint64_t hits;
+        std::uint64_t misses;
+        std::uint64_t evictions;
+        std::uint64_t expirations;
+        std::size_t entries;
+        std::size_t bytes;
+    };
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        std::string key;
+        std::string value;
+        Clock::time_point expires;
+    };
+    struct Shard {
+        std::mutex mutex;
+        std::list<Entry> lru;
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+        std::size_t bytes = 0;
+    };
+
+    const KeyedSubject *real_subject_;
+    std::chrono::nanoseconds ttl_;
+    std::size_t shard_budget_;
+    mutable std::vector<Shard> shards_;
+    mutable std::atomic<std::uint64_t> hits_{0};
+    mutable std::atomic<std::uint64_t> misses_{0};
+    mutable std::atomic<std::uint64_t> evictions_{0};
+    mutable std::atomic<std::uint64_t> expirations_{0};
+
+    /**
+   * Approximate memory held by one entry: the key twice (list entry and index
+   * key), the value once, plus the list and hash-node overhead.
+   */
+    static std::size_t EntryBytes(const std::string &key, const std::string &value) {
+        return 2 * key.size() + value.size() + sizeof(Entry) + 64;
+    }
+    Shard &ShardFor(const std::string &key) const {
+        return this->shards_[std::hash<std::string>{}(key) % this->shards_.size()];
+    }
+    void Erase(Shard &shard, std::list<Entry>::iterator it) const {
+        shard.bytes -= EntryBytes(it->key, it->value);
+        shard.index.erase(it->key);
+        shard.lru.erase(it);
+    }
+
+public:
+    CachingProxy(const KeyedSubject *real_subject, std::size_t budget_bytes, std::chrono::nanoseconds ttl,
+                 std::size_t shards = 16)
+        : real_subject_{real_subject}, ttl_{ttl}, shard_budget_{budget_bytes / std::max<std::size_t>(shards, 1)},
+          shards_(std::max<std::size_t>(shards, 1))
+        {}
+    std::string Request(const std::string &key) const override {
+        Shard &shard = this->ShardFor(key);
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto found = shard.index.find(key);
+            if (found != shard.index.end()) {
+                if (found->second->expires > Clock::now()) {
+                    shard.lru.splice(shard.lru.begin(), shard.lru, found->second);
+                    this->hits_.fetch_add(1, std::memory_order_relaxed);
+                    return found->second->value;
+                }
+                this->Erase(shard, found->second);
+                this->expirations_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        this->misses_.fetch_add(1, std::memory_order_relaxed);
+        std::string value = this->real_subject_->Request(key);
+        std::size_t bytes = EntryBytes(key, value);
+        if (bytes > this->shard_budget_) {
+            return value;
+        }
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto found = shard.index.find(key);
+        if (found != shard.index.end()) {
+            this->Erase(shard, found->second);
+        }
+        while (!shard.lru.empty() && shard.bytes + bytes > this->shard_budget_) {
+            this->Erase(shard, std::prev(shard.lru.end()));
+            this->evictions_.fetch_add(1, std::memory_order_relaxed);
+        }
+        shard.lru.push_front(Entry{key, value, Clock::now() + this->ttl_});
+        shard.index.emplace(key, shard.lru.begin());
+        shard.bytes += bytes;
+        return value;
+    }
+    Stats stats() const {
+        Stats stats{this->hits_.load(), this->misses_.load(), this->evictions_.load(),
+                    this->expirations_.load(), 0, 0};
+        for (Shard &shard : this->shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            stats.entries += shard.lru.size();
+            stats.bytes += shard.bytes;
+        }
+        return stats;
+    }
+};
+
+std::ostream &operator<<(std::ostream &out, const CachingProxy::Stats &stats) {
+    return out << stats.hits << " hits, " << stats.misses << " misses, " << stats.evictions << " evictions, "
+               << stats.expirations << " expirations, " << stats.entries << " entries in " << stats.bytes
+               << " bytes";
+}
+
+/**
+ * CoalescingProxy lets concurrent requests for the same key share one call to
+ * the real subject. The first request for a key starts a fetch and publishes a
+ * shared future for it; requests that arrive while it is in flight wait on that
+ * future instead of calling the subject again, and all of them receive the
+ * same value, or the same exception. Nothing is kept once the fetch completes:
+ * put a CachingProxy behind or in front of it to also serve later requests.
+ *
+ * With a non-zero `batch_window` it also merges different keys. The first new
+ * key opens a batch and waits up to `batch_window` for more to join, or until
+ * `max_batch` keys are waiting, then fetches them all with one RequestBatch()
+ * call. This trades up to one window of added latency for fewer round trips.
+ * A batch never grows past `max_batch`: keys that arrive while a full batch
+ * is waiting for its sender wait for it to leave and go into the next one.
+ */
+class CoalescingProxy : public KeyedSubject
+{
+public:
+    struct Stats {
+        std::uint64_t requests;
+        std::uint64_t coalesced;
+        std::uint64_t backend_calls;
+        std::uint64_t fetched_keys;
+    };
+
+private:
+    struct Pending {
+        std::string key;
+        std::promise<std::string> promise;
+    };
+
+    const KeyedSubject *real_subject_;
+    std::chrono::nanoseconds batch_window_;
+    std::size_t max_batch_;
+    mutable std::mutex mutex_;
+    mutable std::condition_variable batch_full_;
+    mutable std::condition_variable batch_taken_;
+    mutable std::unordered_map<std::string, std::shared_future<std::string>> in_flight_;
+    mutable std::vector<Pending> batch_;
+    mutable std::atomic<std::uint64_t> requests_{0};
+    mutable std::atomic<std::uint64_t> coalesced_{0};
+    mutable std::atomic<std::uint64_t> backend_calls_{0};
+    mutable std::atomic<std::uint64_t> fetched_keys_{0};
+
+    /**
+   * Fetches every key in `batch` with one call to the real subject, hands the
+   * results to their waiters and retires the keys, so the next request for
+   * them starts a fresh fetch.
+   */
+    void Fetch(std::vector<Pending> &batch) const {
+        this->backend_calls_.fetch_add(1, std::memory_order_relaxed);
+        this->fetched_keys_.fetch_add(batch.size(), std::memory_order_relaxed);
+        try {
+            if (batch.size() == 1) {
+                batch.front().promise.set_value(this->real_subject_->Request(batch.front().key));
+            } else {
+                std::vector<std::string> keys;
+                keys.reserve(batch.size());
+                for (const Pending &pending : batch) {
+                    keys.push_back(pending.key);
+                }
+                std::vector<std::string> values = this->real_subject_->RequestBatch(keys);
+                if (values.size() != batch.size()) {
+                    throw std::runtime_error("RequestBatch returned the wrong number of values");
+                }
+                for (std::size_t i = 0; i < batch.size(); ++i) {
+                    batch[i].promise.set_value(std::move(values[i]));
+                }
+            }
+        } catch (...) {
+            for (Pending &pending : batch) {
+                try {
+                    pending.promise.set_exception(std::current_exception());
+                } catch (const std::future_error &) {
+                    // Already answered before the failure.
+                }
+            }
+        }
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        for (const Pending &pending : batch) {
+            this->in_flight_.erase(pending.key);
+        }
+    }
+
+public:
+    CoalescingProxy(const KeyedSubject *real_subject, std::chrono::nanoseconds batch_window = std::chrono::nanoseconds(0),
+                    std::size_t max_batch = 64)
+        : real_subject_{real_subject}, batch_window_{batch_window}, max_batch_{std::max<std::size_t>(max_batch, 1)}
+        {}
+    std::string Request(const std::string &key) const override {
+        this->requests_.fetch_add(1, std::memory_order_relaxed);
+        std::unique_lock<std::mutex> lock(this->mutex_);
+        auto found = this->in_flight_.find(key);
+        if (found != this->in_flight_.end()) {
+            std::shared_future<std::string> result = found->second;
+            lock.unlock();
+            this->coalesced_.fetch_add(1, std::memory_order_relaxed);
+            return result.get();
+        }
+
+        std::vector<Pending> batch;
+        batch.push_back(Pending{key, std::promise<std::string>()});
+        std::shared_future<std::string> result = batch.back().promise.get_future().share();
+        this->in_flight_.emplace(key, result);
+        if (this->batch_window_.count() > 0) {
+            this->batch_taken_.wait(lock, [this] { return this->batch_.size() < this->max_batch_; });
+            this->batch_.push_back(std::move(batch.back()));
+            batch.clear();
+            if (this->batch_.size() == 1) {
+                // This request opened the batch, so it is the one that sends it.
+                this->batch_full_.wait_for(lock, this->batch_window_,
+                                           [this] { return this->batch_.size() >= this->max_batch_; });
+                batch.swap(this->batch_);
+                this->batch_taken_.notify_all();
+            } else if (this->batch_.size() >= this->max_batch_) {
+                this->batch_full_.notify_one();
+            }
+        }
+        lock.unlock();
+        if (!batch.empty()) {
+            this->Fetch(batch);
+        }
+        return result.get();
+    }
+    Stats stats() const {
+        return Stats{this->requests_.load(), this->coalesced_.load(), this->backend_calls_.load(),
+                     this->fetched_keys_.load()};
+    }
+};
+
+std::ostream &operator<<(std::ostream &out, const CoalescingProxy::Stats &stats) {
+    return out << stats.requests << " requests, " << stats.coalesced << " coalesced, " << stats.backend_calls
+               << " backend calls for " << stats.fetched_keys << " keys";
+}
+
+/**
+ * LazyProxy is a virtual proxy: it builds its subject with `factory` on the
+ * first Request() instead of up front, so subjects that are never used cost
+ * nothing but the proxy itself. Concurrent first calls race for a mutex and the
+ * subject is built exactly once; every later call is a lock-free atomic load.
+ *
+ * With a non-zero `idle_timeout` the subject can also be unloaded again by
+ * UnloadIfIdle() once it has not been used for that long, and is rebuilt on
+ * the next request. Requests only raise a `touched_` flag; UnloadIfIdle()
+ * clears it and measures idleness from the last call that found it raised, so
+ * idle time is as precise as the interval between those calls and no request
+ * reads the clock. Requests also announce themselves in an active-reader
+ * count, and unloading waits for that count to drain before deleting, so a
+ * request never sees its subject freed underneath it.
+ */
+class LazyProxy : public Subject
+{
+private:
+    using Clock = std::chrono::steady_clock;
+
+    std::function<std::unique_ptr<Subject>()> factory_;
+    std::chrono::nanoseconds idle_timeout_;
+    mutable std::atomic<Subject*> subject_{nullptr};
+    mutable std::atomic<std::size_t> readers_{0};
+    mutable std::atomic<bool> touched_{false};
+    mutable Clock::time_point last_seen_;
+    mutable std::atomic<std::uint64_t> loads_{0};
+    mutable std::mutex mutex_;
+
+    Subject *Load() const {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        Subject *subject = this->subject_.load(std::memory_order_acquire);
+        if (!subject) {
+            subject = this->factory_().release();
+            this->loads_.fetch_add(1, std::memory_order_relaxed);
+            this->last_seen_ = Clock::now();
+            this->subject_.store(subject, std::memory_order_release);
+        }
+        return subject;
+    }
+
+public:
+    LazyProxy(std::function<std::unique_ptr<Subject>()> factory,
+              std::chrono::nanoseconds idle_timeout = std::chrono::nanoseconds::zero())
+        : factory_{std::move(factory)}, idle_timeout_{idle_timeout}
+        {}
+    ~LazyProxy() {
+        delete this->subject_.load();
+    }
+    void Request() const override {
+        if (this->idle_timeout_ == std::chrono::nanoseconds::zero()) {
+            Subject *subject = this->subject_.load(std::memory_order_acquire);
+            (subject ? subject : this->Load())->Request();
+            return;
+        }
+        Subject *subject;
+        for (;;) {
+            this->readers_.fetch_add(1);
+            subject = this->subject_.load();
+            if (subject) {
+                break;
+            }
+            this->readers_.fetch_sub(1);
+            this->Load();
+        }
+        subject->Request();
+        if (!this->touched_.load(std::memory_order_relaxed)) {
+            this->touched_.store(true, std::memory_order_relaxed);
+        }
+        this->readers_.fetch_sub(1, std::memory_order_release);
+    }
+    /**
+   * Deletes the subject if idle unloading is enabled and it has not been used
+   * for `idle_timeout`. Returns whether it did.
+   */
+    bool UnloadIfIdle() const {
+        if (this->idle_timeout_ == std::chrono::nanoseconds::zero()) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        if (!this->subject_.load()) {
+            return false;
+        }
+        if (this->touched_.exchange(false, std::memory_order_relaxed)) {
+            this->last_seen_ = Clock::now();
+            return false;
+        }
+        if (Clock::now() - this->last_seen_ < this->idle_timeout_) {
+            return false;
+        }
+        Subject *subject = this->subject_.exchange(nullptr);
+        while (this->readers_.load() != 0) {
+            std::this_thread::yield();
+        }
+        delete subject;
+        return true;
+    }
+    bool loaded() const {
+        return this->subject_.load(std::memory_order_acquire) != nullptr;
+    }
+    std::uint64_t loads() const {
+        return this->loads_.load(std::memory_order_relaxed);
+    }
+};
+
+/**
+ * IdleReaper periodically offers every registered LazyProxy the chance to
+ * unload its subject.
+ */
+class IdleReaper
+{
+private:
+    std::vector<const LazyProxy*> proxies_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+    std::thread thread_;
+
+public:
+    IdleReaper(std::chrono::nanoseconds period)
+        : thread_{[this, period] {
+            std::unique_lock<std::mutex> lock(this->mutex_);
+            while (!this->cv_.wait_for(lock, period, [this] { return this->stop_; })) {
+                for (const LazyProxy *proxy : this->proxies_) {
+                    proxy->UnloadIfIdle();
+                }
+            }
+        }}
+        {}
+    ~IdleReaper() {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex_);
+            this->stop_ = true;
+        }
+        this->cv_.notify_one();
+        this->thread_.join();
+    }
+    void Watch(const LazyProxy *proxy) {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        this->proxies_.push_back(proxy);
+    }
+};
+
+/**
+ * A subject that is expensive to build: it owns and initializes a buffer of
+ * `bytes` bytes. Its requests are cheap and silent.
+ */
+class HeavySubject : public Subject
+{
+private:
+    std::vector<unsigned char> buffer_;
+    mutable std::atomic<std::uint64_t> requests_{0};
+
+public:
+    HeavySubject(std::size_t bytes)
+        : buffer_(bytes)
+    {
+        for (std::size_t i = 0; i < bytes; ++i) {
+            this->buffer_[i] = static_cast<unsigned char>(i * 31);
+        }
+    }
+    void Request() const override {
+        this->requests_.fetch_add(this->buffer_[0] + 1, std::memory_order_relaxed);
+    }
+};
+
+/**
+ * One access-log entry. Records are fixed-size and binary so that logging is a
+ * copy into a ring; turning them into text happens on the drainer thread.
+ */
+struct AccessRecord {
+    enum Event : std::uint32_t { kCheckAccess, kRequest };
+
+    std::int64_t timestamp;
+    std::uint64_t sequence;
+    std::uint32_t thread;
+    Event event;
+};
+
+/**
+ * A bounded single-producer/single-consumer ring. The producer and consumer
+ * each own one index and only read the other's, so neither ever waits; a full
+ * ring rejects the record and counts it as dropped instead. The producer keeps
+ * a private copy of the consumer's index and only rereads the shared one when
+ * the ring looks full, so a push normally touches no shared cache line but
+ * the slot itself. The capacity is rounded up to a power of two so that an
+ * index maps to its slot with a mask.
+ */
+class AccessRing
+{
+private:
+    std::vector<AccessRecord> records_;
+    std::size_t mask_;
+    alignas(64) std::atomic<std::size_t> head_{0};
+    alignas(64) std::atomic<std::size_t> tail_{0};
+    std::size_t cached_head_ = 0;
+    std::atomic<std::uint64_t> dropped_{0};
+    std::atomic<bool> retired_{false};
+
+    static std::size_t RoundUpToPowerOfTwo(std::size_t n) {
+        std::size_t capacity = 1;
+        while (capacity < n) {
+            capacity <<= 1;
+        }
+        return capacity;
+    }
+
+public:
+    AccessRing(std::size_t capacity)
+        : records_(RoundUpToPowerOfTwo(capacity)), mask_{records_.size() - 1}
+        {}
+    bool TryPush(const AccessRecord &record) {
+        std::size_t tail = this->tail_.load(std::memory_order_relaxed);
+        if (tail - this->cached_head_ == this->records_.size()) {
+            this->cached_head_ = this->head_.load(std::memory_order_acquire);
+            if (tail - this->cached_head_ == this->records_.size()) {
+                this->dropped_.store(this->dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+        this->records_[tail & this->mask_] = record;
+        this->tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+    /**
+   * Hands every queued record to `consume` and returns how many there were.
+   */
+    template <typename Consume>
+    std::size_t Drain(Consume &&consume) {
+        std::size_t head = this->head_.load(std::memory_order_relaxed);
+        std::size_t tail = this->tail_.load(std::memory_order_acquire);
+        for (std::size_t i = head; i != tail; ++i) {
+            consume(this->records_[i & this->mask_]);
+        }
+        this->head_.store(tail, std::memory_order_release);
+        return tail - head;
+    }
+    std::uint64_t dropped() const {
+        return this->dropped_.load(std::memory_order_relaxed);
+    }
+    /**
+   * Called by the producer when it will push no more. Everything it pushed
+   * before is visible to a consumer that has seen retired() return true.
+   */
+    void Retire() {
+        this->retired_.store(true, std::memory_order_release);
+    }
+    bool retired() const {
+        return this->retired_.load(std::memory_order_acquire);
+    }
+};
+
+/**
+ * AsyncLogger takes access records from any number of threads without locks
+ * on the logging path: each thread gets its own AccessRing the first time it
+ * logs, and a background thread drains all rings, formats the records and
+ * writes them to `path` in large batches. It wakes once per `kDrainInterval`
+ * rather than spinning, so it takes little CPU away from request threads; the
+ * rings absorb what arrives in between. Records that arrive while a ring is
+ * full are dropped and counted, so a slow disk never slows requests down;
+ * so are records the file refuses to take. A thread's ring is retired when the
+ * thread exits and freed once the drainer has emptied it, so servers that run
+ * a thread per request do not accumulate rings.
+ */
+class AsyncLogger
+{
+private:
+    static constexpr std::size_t kBatchBytes = 64 << 10;
+    static constexpr std::chrono::microseconds kDrainInterval{500};
+
+    /**
+   * The rings a thread logs to, one per logger. When the thread exits it
+   * retires those of its rings whose logger is still alive.
+   */
+    struct ThreadRings {
+        struct Entry {
+            std::uint64_t logger;
+            AccessRing *ring;
+            std::uint32_t thread;
+            std::weak_ptr<AccessRing> owner;
+        };
+        std::vector<Entry> entries;
+
+        ~ThreadRings() {
+            for (Entry &entry : this->entries) {
+                if (std::shared_ptr<AccessRing> ring = entry.owner.lock()) {
+                    ring->Retire();
+                }
+            }
+        }
+    };
+
+    std::size_t ring_capacity_;
+    std::uint64_t id_;
+    int fd_;
+    std::mutex rings_mutex_;
+    std::vector<std::shared_ptr<AccessRing>> rings_;
+    std::uint32_t next_thread_ = 0;
+    std::uint64_t retired_dropped_ = 0;
+    std::atomic<bool> stop_{false};
+    std::atomic<std::uint64_t> written_{0};
+    std::atomic<std::uint64_t> lost_{0};
+    std::size_t batch_records_ = 0;
+    std::thread drainer_;
+
+    static std::uint64_t NextId() {
+        static std::atomic<std::uint64_t> next{1};
+        return next.fetch_add(1);
+    }
+    /**
+   * The calling thread's ring. Loggers are told apart by id rather than by
+   * address, so a new logger at a dead one's address is not mistaken for it.
+   */
+    AccessRing &ThreadRing(std::uint32_t &thread) {
+        thread_local ThreadRings rings;
+        for (const ThreadRings::Entry &entry : rings.entries) {
+            if (entry.logger == this->id_) {
+                thread = entry.thread;
+                return *entry.ring;
+            }
+        }
+        // Forget the rings of loggers that are gone before adding this one.
+        rings.entries.erase(std::remove_if(rings.entries.begin(), rings.entries.end(),
+                                           [](const ThreadRings::Entry &entry) { return entry.owner.expired(); }),
+                            rings.entries.end());
+        std::lock_guard<std::mutex> lock(this->rings_mutex_);
+        this->rings_.push_back(std::make_shared<AccessRing>(this->ring_capacity_));
+        thread = this->next_thread_++;
+        rings.entries.push_back({this->id_, this->rings_.back().get(), thread, this->rings_.back()});
+        return *this->rings_.back();
+    }
+    static void AppendNumber(std::string &out, std::uint64_t value) {
+        char digits[20];
+        int n = 0;
+        do {
+            digits[n++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+        while (n > 0) {
+            out += digits[--n];
+        }
+    }
+    /**
+   * Only the drainer thread removes rings, so the pointers taken under the
+   * lock stay valid while it drains them without it.
+   */
+    std::size_t DrainOnce(std::string &batch) {
+        std::vector<AccessRing*> rings;
+        {
+            std::lock_guard<std::mutex> lock(this->rings_mutex_);
+            for (const std::shared_ptr<AccessRing> &ring : this->rings_) {
+                rings.push_back(ring.get());
+            }
+        }
+        std::size_t drained = 0;
+        std::vector<AccessRing*> emptied;
+        for (AccessRing *ring : rings) {
+            // Checked before draining, so whatever the owner pushed before
+            // retiring is drained below and the ring is then empty for good.
+            if (ring->retired()) {
+                emptied.push_back(ring);
+            }
+            drained += ring->Drain([&](const AccessRecord &record) {
+                AppendNumber(batch, static_cast<std::uint64_t>(record.timestamp));
+                batch += " thread ";
+                AppendNumber(batch, record.thread);
+                batch += " #";
+                AppendNumber(batch, record.sequence);
+                batch += record.event == AccessRecord::kCheckAccess ? " check-access\n" : " request\n";
+                ++this->batch_records_;
+                if (batch.size() >= kBatchBytes) {
+                    this->Write(batch);
+                }
+            });
+        }
+        if (!emptied.empty()) {
+            std::lock_guard<std::mutex> lock(this->rings_mutex_);
+            auto retired = std::partition(this->rings_.begin(), this->rings_.end(),
+                                          [&](const std::shared_ptr<AccessRing> &ring) {
+                                              return std::find(emptied.begin(), emptied.end(), ring.get())
+                                                  == emptied.end();
+                                          });
+            for (auto it = retired; it != this->rings_.end(); ++it) {
+                this->retired_dropped_ += (*it)->dropped();
+            }
+            this->rings_.erase(retired, this->rings_.end());
+        }
+        return drained;
+    }
+    /**
+   * Writes out `batch` and counts its records as written, or, for the lines
+   * the file did not take in full, as lost.
+   */
+    void Write(std::string &batch) {
+        std::size_t done = 0;
+        while (done < batch.size()) {
+            ssize_t n = ::write(this->fd_, batch.data() + done, batch.size() - done);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+            done += static_cast<std::size_t>(n);
+        }
+        std::size_t lost = static_cast<std::size_t>(std::count(batch.begin() + done, batch.end(), '\n'));
+        this->written_.fetch_add(this->batch_records_ - lost, std::memory_order_relaxed);
+        this->lost_.fetch_add(lost, std::memory_order_relaxed);
+        this->batch_records_ = 0;
+        batch.clear();
+    }
+
+public:
+    /**
+   * `ring_capacity` is per thread and is rounded up to a power of two.
+   */
+    AsyncLogger(const std::string &path, std::size_t ring_capacity = 4096)
+        : ring_capacity_{ring_capacity}, id_{NextId()},
+          fd_{open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644)}
+    {
+        if (this->fd_ < 0) {
+            throw std::runtime_error("AsyncLogger: cannot open " + path);
+        }
+        this->drainer_ = std::thread([this] {
+            std::string batch;
+            while (!this->stop_.load(std::memory_order_acquire)) {
+                this->DrainOnce(batch);
+                this->Write(batch);
+                std::this_thread::sleep_for(kDrainInterval);
+            }
+            this->DrainOnce(batch);
+            this->Write(batch);
+        });
+    }
+    ~AsyncLogger() {
+        this->stop_.store(true, std::memory_order_release);
+        this->drainer_.join();
+        close(this->fd_);
+    }
+    AsyncLogger(const AsyncLogger &) = delete;
+    AsyncLogger &operator=(const AsyncLogger &) = delete;
+
+    static std::int64_t Now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+    /**
+   * Called on the request path: a copy into this thread's ring. Returns false
+   * if the record had to be dropped.
+   */
+    bool Log(AccessRecord::Event event, std::uint64_t sequence, std::int64_t timestamp) {
+        std::uint32_t thread;
+        AccessRing &ring = this->ThreadRing(thread);
+        return ring.TryPush(AccessRecord{timestamp, sequence, thread, event});
+    }
+    std::uint64_t written() const {
+        return this->written_.load(std::memory_order_relaxed);
+    }
+    /**
+   * Records rejected by a full ring plus records the file did not take.
+   */
+    std::uint64_t dropped() {
+        std::lock_guard<std::mutex> lock(this->rings_mutex_);
+        std::uint64_t dropped = this->retired_dropped_ + this->lost_.load(std::memory_order_relaxed);
+        for (const std::shared_ptr<AccessRing> &ring : this->rings_) {
+            dropped += ring->dropped();
+        }
+        return dropped;
+    }
+};
+
+/**
+ * The same proxy as Proxy, but its access checks and request log go to an
+ * AsyncLogger instead of being written to std::cout on the request path.
+ */
+class LoggingProxy : public Subject
+{
+private:
+    static constexpr std::uint64_t kSequenceBlock = 4096;
+
+    const Subject *real_subject_;
+    AsyncLogger *logger_;
+    std::uint64_t id_;
+    mutable std::atomic<std::uint64_t> sequence_{0};
+
+    static std::uint64_t NextId() {
+        static std::atomic<std::uint64_t> next{1};
+        return next.fetch_add(1);
+    }
+    /**
+   * Request numbers are handed to each thread in blocks of kSequenceBlock. A
+   * locked increment per request would also wait for the previous request's
+   * ring stores to drain, which made it the largest part of the p99. Numbers
+   * are unique and increase within a thread, but have gaps and are not ordered
+   * across threads.
+   */
+    std::uint64_t NextSequence() const {
+        struct Block {
+            std::uint64_t proxy;
+            std::uint64_t next;
+            std::uint64_t end;
+        };
+        thread_local Block block{0, 0, 0};
+        if (block.proxy != this->id_ || block.next == block.end) {
+            block.proxy = this->id_;
+            block.next = this->sequence_.fetch_add(kSequenceBlock, std::memory_order_relaxed);
+            block.end = block.next + kSequenceBlock;
+        }
+        return block.next++;
+    }
+
+    bool CheckAccess(std::uint64_t sequence, std::int64_t now) const {
+        // Some real checks sould go here.
+        this->logger_->Log(AccessRecord::kCheckAccess, sequence, now);
+        return true;
+    }
+    void LogAccess(std::uint64_t sequence, std::int64_t now) const {
+        this->logger_->Log(AccessRecord::kRequest, sequence, now);
+    }
+
+public:
+    LoggingProxy(const Subject *real_subject, AsyncLogger *logger)
+        : real_subject_{real_subject}, logger_{logger}, id_{NextId()}
+        {}
+    /**
+   * Both records carry the time the request arrived: a clock read costs as much
+   * as the rest of the logging path, so it is taken once.
+   */
+    void Request() const override {
+        std::uint64_t sequence = this->NextSequence();
+        std::int64_t now = AsyncLogger::Now();
+        if (this->CheckAccess(sequence, now)) {
+            this->real_subject_->Request();
+            this->LogAccess(sequence, now);
+        }
+    }
+};
+
+/**
+ * A reliable byte stream to another process. Write() and Read() block until
+ * all `size` bytes have gone through; HasData() says whether Read() has bytes
+ * ready without waiting, so a reader can tell when to flush what it owes.
+ */
+class Channel
+{
+public:
+    virtual void Write(const void *data, std::size_t size) = 0;
+    virtual void Read(void *data, std::size_t size) = 0;
+    virtual bool HasData() const = 0;
+    virtual ~Channel() {}
+};
+
+/**
+ * A wait/notify word in memory shared between processes. A waiter spins for a
+ * while, then registers, rechecks its condition and only then sleeps on a
+ * futex, so a notification between the check and the sleep is never lost; a
+ * notifier makes the wake system call only when someone is registered. Sleeps
+ * time out now and then to ask `peer_alive` whether waiting still makes sense.
+ */
+struct SharedEvent {
+    std::atomic<std::uint32_t> sequence{0};
+    std::atomic<std::uint32_t> waiters{0};
+
+    void Notify() {
+        this->sequence.fetch_add(1, std::memory_order_seq_cst);
+        if (this->waiters.load(std::memory_order_seq_cst) != 0) {
+            syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&this->sequence), FUTEX_WAKE, INT_MAX, nullptr,
+                    nullptr, 0);
+        }
+    }
+    template <typename Ready>
+    void Wait(Ready ready, unsigned spins, const std::function<bool()> &peer_alive) {
+        for (unsigned i = 0; i < spins && !ready(); ++i) {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        }
+        while (!ready()) {
+            this->waiters.fetch_add(1, std::memory_order_seq_cst);
+            std::uint32_t sequence = this->sequence.load(std::memory_order_seq_cst);
+            if (!ready()) {
+                timespec timeout{0, 50 * 1000 * 1000};
+                syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&this->sequence), FUTEX_WAIT, sequence, &timeout,
+                        nullptr, 0);
+            }
+            this->waiters.fetch_sub(1, std::memory_order_seq_cst);
+            if (!ready() && !peer_alive()) {
+                throw std::runtime_error("RemoteProxy: the other process has gone away");
+            }
+        }
+    }
+};
+
+/**
+ * One direction of a ShmChannel: a single-producer/single-consumer byte ring
+ * in a shared mapping, its `capacity` bytes of data right after this header.
+ * Either side sleeps only when the ring is empty or full, respectively.
+ */
+class SharedRing
+{
+private:
+    alignas(64) std::atomic<std::uint64_t> head_{0};
+    alignas(64) std::atomic<std::uint64_t> tail_{0};
+    alignas(64) SharedEvent readable_;
+    alignas(64) SharedEvent writable_;
+    std::uint64_t capacity_;
+
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "SharedRing needs address-free atomics");
+
+    unsigned char *bytes() {
+        return reinterpret_cast<unsigned char *>(this + 1);
+    }
+
+public:
+    explicit SharedRing(std::uint64_t capacity)
+        : capacity_{capacity}
+        {}
+    static std::size_t Footprint(std::uint64_t capacity) {
+        return sizeof(SharedRing) + capacity;
+    }
+    void Write(const unsigned char *data, std::size_t size, unsigned spins, const std::function<bool()> &peer_alive) {
+        while (size > 0) {
+            std::uint64_t tail = this->tail_.load(std::memory_order_relaxed);
+            this->writable_.Wait([&] { return tail - this->head_.load(std::memory_order_acquire) < this->capacity_; },
+                                 spins, peer_alive);
+            std::uint64_t space = this->capacity_ - (tail - this->head_.load(std::memory_order_acquire));
+            std::size_t n = static_cast<std::size_t>(std::min<std::uint64_t>(size, space));
+            std::size_t offset = static_cast<std::size_t>(tail & (this->capacity_ - 1));
+            std::size_t first = std::min<std::size_t>(n, this->capacity_ - offset);
+            std::memcpy(this->bytes() + offset, data, first);
+            std::memcpy(this->bytes(), data + first, n - first);
+            this->tail_.store(tail + n, std::memory_order_release);
+            this->readable_.Notify();
+            data += n;
+            size -= n;
+        }
+    }
+    void Read(unsigned char *data, std::size_t size, unsigned spins, const std::function<bool()> &peer_alive) {
+        while (size > 0) {
+            std::uint64_t head = this->head_.load(std::memory_order_relaxed);
+            this->readable_.Wait([&] { return this->tail_.load(std::memory_order_acquire) != head; }, spins,
+                                 peer_alive);
+            std::uint64_t available = this->tail_.load(std::memory_order_acquire) - head;
+            std::size_t n = static_cast<std::size_t>(std::min<std::uint64_t>(size, available));
+            std::size_t offset = static_cast<std::size_t>(head & (this->capacity_ - 1));
+            std::size_t first = std::min<std::size_t>(n, this->capacity_ - offset);
+            std::memcpy(data, this->bytes() + offset, first);
+            std::memcpy(data + first, this->bytes(), n - first);
+            this->head_.store(head + n, std::memory_order_release);
+            this->writable_.Notify();
+            data += n;
+            size -= n;
+        }
+    }
+    bool HasData() const {
+        return this->tail_.load(std::memory_order_acquire) != this->head_.load(std::memory_order_relaxed);
+    }
+};
+
+/**
+ * A Channel over two SharedRings, one each way. Waits spin briefly before
+ * sleeping when there is another core for the peer to run on, and go straight
+ * to sleep when there is not, since spinning would only delay the peer.
+ */
+class ShmChannel : public Channel
+{
+private:
+    SharedRing *out_;
+    SharedRing *in_;
+    unsigned spins_;
+    std::function<bool()> peer_alive_;
+
+public:
+    ShmChannel(SharedRing *out, SharedRing *in, std::function<bool()> peer_alive)
+        : out_{out}, in_{in}, spins_{std::thread::hardware_concurrency() > 1 ? 4000u : 0u},
+          peer_alive_{std::move(peer_alive)}
+        {}
+    void Write(const void *data, std::size_t size) override {
+        this->out_->Write(static_cast<const unsigned char *>(data), size, this->spins_, this->peer_alive_);
+    }
+    void Read(void *data, std::size_t size) override {
+        this->in_->Read(static_cast<unsigned char *>(data), size, this->spins_, this->peer_alive_);
+    }
+    bool HasData() const override {
+        return this->in_->HasData();
+    }
+};
+
+/**
+ * A Channel over one end of a Unix-domain socketpair. Reads go through a
+ * buffer, so one system call picks up every frame already sent.
+ */
+class SocketChannel : public Channel
+{
+private:
+    int fd_;
+    std::vector<unsigned char> buffer_;
+    std::size_t begin_ = 0;
+    std::size_t end_ = 0;
+
+public:
+    explicit SocketChannel(int fd)
+        : fd_{fd}, buffer_(64 << 10)
+        {}
+    ~SocketChannel() {
+        close(this->fd_);
+    }
+    void Write(const void *data, std::size_t size) override {
+        const unsigned char *bytes = static_cast<const unsigned char *>(data);
+        while (size > 0) {
+            ssize_t n = send(this->fd_, bytes, size, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0) {
+                throw std::runtime_error("RemoteProxy: the other process has gone away");
+            }
+            bytes += n;
+            size -= static_cast<std::size_t>(n);
+        }
+    }
+    void Read(void *data, std::size_t size) override {
+        unsigned char *bytes = static_cast<unsigned char *>(data);
+        while (size > 0) {
+            if (this->begin_ == this->end_) {
+                ssize_t n = read(this->fd_, this->buffer_.data(), this->buffer_.size());
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n <= 0) {
+                    throw std::runtime_error("RemoteProxy: the other process has gone away");
+                }
+                this->begin_ = 0;
+                this->end_ = static_cast<std::size_t>(n);
+            }
+            std::size_t n = std::min(size, this->end_ - this->begin_);
+            std::memcpy(bytes, this->buffer_.data() + this->begin_, n);
+            this->begin_ += n;
+            bytes += n;
+            size -= n;
+        }
+    }
+    bool HasData() const override {
+        return this->begin_ != this->end_;
+    }
+};
+
+/**
+ * RemoteProxy is a remote proxy: its subject is built by `factory` in a child
+ * process that the constructor forks, and every request travels there and
+ * back as a frame over a Channel. A crash in the subject takes down only the
+ * child; the proxy then fails requests with std::runtime_error.
+ *
+ * The default transport is a pair of byte rings in a shared anonymous mapping,
+ * where a round trip costs two memory copies and a futex wake-up only if the
+ * other side is asleep. If that mapping cannot be made, or kSocket is asked
+ * for, it falls back to a Unix-domain socketpair. Request() is one round trip.
+ * Pipeline() keeps up to `depth` requests in flight, and RequestBatch() sends
+ * all its keys as one frame that the subject answers with one RequestBatch()
+ * of its own. The child holds back its replies while more requests are already
+ * waiting and then sends them in one write, so both cost far fewer wake-ups
+ * per request. Replies to `depth` pipelined requests must fit in `ring_bytes`,
+ * and no frame may carry more than kMaxFrameBytes.
+ *
+ * Construct it before starting other threads: the child inherits only the
+ * thread that forked it.
+ */
+class RemoteProxy : public KeyedSubject
+{
+public:
+    enum Transport { kSharedMemory, kSocket };
+
+private:
+    enum Kind : std::uint32_t { kRequest, kBatch, kReply, kError, kShutdown };
+    struct FrameHeader {
+        std::uint64_t id;
+        std::uint32_t kind;
+        std::uint32_t length;
+    };
+    static constexpr std::size_t kFlushBytes = 64 << 10;
+    static constexpr std::size_t kMaxFrameBytes = std::size_t(256) << 20;
+
+    Transport transport_;
+    void *shared_ = MAP_FAILED;
+    std::size_t shared_bytes_ = 0;
+    pid_t server_ = -1;
+    bool server_reaped_ = false;
+    std::unique_ptr<Channel> channel_;
+    mutable std::mutex mutex_;
+    mutable std::uint64_t next_id_ = 0;
+
+    /**
+   * Item lengths travel as 32 bits, so anything larger is refused rather than
+   * truncated.
+   */
+    static std::uint32_t WireLength(std::size_t size) {
+        if (size > UINT32_MAX) {
+            throw std::runtime_error("RemoteProxy: payload larger than 4 GiB");
+        }
+        return static_cast<std::uint32_t>(size);
+    }
+    static void AppendFrame(std::string &out, Kind kind, std::uint64_t id, const std::string &payload) {
+        if (payload.size() > kMaxFrameBytes) {
+            throw std::runtime_error("RemoteProxy: payload larger than the maximum frame size");
+        }
+        FrameHeader header{id, kind, static_cast<std::uint32_t>(payload.size())};
+        out.append(reinterpret_cast<const char *>(&header), sizeof(header));
+        out += payload;
+    }
+    /**
+   * The header comes from the other process, so it is checked before anything
+   * is allocated for it: a bad one means the stream is out of step.
+   */
+    static Kind ReadFrame(Channel &channel, std::uint64_t &id, std::string &payload) {
+        FrameHeader header;
+        channel.Read(&header, sizeof(header));
+        if (header.kind > kShutdown) {
+            throw std::runtime_error("RemoteProxy: unknown frame kind");
+        }
+        if (header.length > kMaxFrameBytes) {
+            throw std::runtime_error("RemoteProxy: frame larger than the maximum frame size");
+        }
+        payload.resize(header.length);
+        channel.Read(&payload[0], header.length);
+        id = header.id;
+        return static_cast<Kind>(header.kind);
+    }
+    static std::string Pack(const std::vector<std::string> &items) {
+        std::string packed;
+        for (const std::string &item : items) {
+            std::uint32_t length = WireLength(item.size());
+            packed.append(reinterpret_cast<const char *>(&length), sizeof(length));
+            packed += item;
+        }
+        return packed;
+    }
+    static std::vector<std::string> Unpack(const std::string &packed) {
+        std::vector<std::string> items;
+        for (std::size_t at = 0; at < packed.size();) {
+            std::uint32_t length;
+            if (packed.size() - at < sizeof(length)) {
+                throw std::runtime_error("RemoteProxy: truncated item length");
+            }
+            std::memcpy(&length, packed.data() + at, sizeof(length));
+            at += sizeof(length);
+            if (packed.size() - at < length) {
+                throw std::runtime_error("RemoteProxy: item overruns its frame");
+            }
+            items.push_back(packed.substr(at, length));
+            at += length;
+        }
+        return items;
+    }
+    /**
+   * The child's loop: answer frames in order until told to stop, flushing the
+   * replies only when no further request is already waiting.
+   */
+    static void Serve(Channel &channel, const KeyedSubject &subject) {
+        std::string request;
+        std::string replies;
+        for (;;) {
+            std::uint64_t id;
+            Kind kind = ReadFrame(channel, id, request);
+            if (kind == kShutdown) {
+                return;
+            }
+            if (kind != kRequest && kind != kBatch) {
+                throw std::runtime_error("RemoteProxy: unexpected request");
+            }
+            try {
+                if (kind == kBatch) {
+                    AppendFrame(replies, kReply, id, Pack(subject.RequestBatch(Unpack(request))));
+                } else {
+                    AppendFrame(replies, kReply, id, subject.Request(request));
+                }
+            } catch (const std::exception &e) {
+                AppendFrame(replies, kError, id, e.what());
+            }
+            if (!channel.HasData() || replies.size() >= kFlushBytes) {
+                channel.Write(replies.data(), replies.size());
+                replies.clear();
+            }
+        }
+    }
+    Kind ReadReply(std::uint64_t id, std::string &payload) const {
+        std::uint64_t reply_id;
+        Kind kind = ReadFrame(*this->channel_, reply_id, payload);
+        if (reply_id != id || (kind != kReply && kind != kError)) {
+            throw std::runtime_error("RemoteProxy: unexpected reply");
+        }
+        return kind;
+    }
+
+public:
+    RemoteProxy(std::function<std::unique_ptr<KeyedSubject>()> factory, Transport transport = kSharedMemory,
+                std::size_t ring_bytes = 1 << 20)
+        : transport_{transport}
+    {
+        std::uint64_t capacity = 4096;
+        while (capacity < ring_bytes) {
+            capacity <<= 1;
+        }
+        if (this->transport_ == kSharedMemory) {
+            this->shared_bytes_ = 2 * SharedRing::Footprint(capacity);
+            this->shared_ = mmap(nullptr, this->shared_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+                                 -1, 0);
+            if (this->shared_ == MAP_FAILED) {
+                this->transport_ = kSocket;
+            }
+        }
+        int sockets[2] = {-1, -1};
+        SharedRing *to_server = nullptr;
+        SharedRing *to_client = nullptr;
+        if (this->transport_ == kSharedMemory) {
+            to_server = new (this->shared_) SharedRing(capacity);
+            to_client = new (static_cast<unsigned char *>(this->shared_) + SharedRing::Footprint(capacity))
+                SharedRing(capacity);
+        } else if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) {
+            throw std::runtime_error("RemoteProxy: cannot create a socketpair");
+        }
+
+        // Anything still buffered would otherwise be printed by both processes.
+        std::cout.flush();
+        std::fflush(nullptr);
+        pid_t parent = getpid();
+        this->server_ = fork();
+        if (this->server_ < 0) {
+            if (this->shared_ != MAP_FAILED) {
+                munmap(this->shared_, this->shared_bytes_);
+            } else {
+                close(sockets[0]);
+                close(sockets[1]);
+            }
+            throw std::runtime_error("RemoteProxy: cannot fork the server process");
+        }
+        if (this->server_ == 0) {
+            int status = 0;
+            try {
+                std::unique_ptr<Channel> channel;
+                if (this->transport_ == kSharedMemory) {
+                    channel = std::make_unique<ShmChannel>(to_client, to_server, [parent] { return getppid() == parent; });
+                } else {
+                    close(sockets[0]);
+                    channel = std::make_unique<SocketChannel>(sockets[1]);
+                }
+                std::unique_ptr<KeyedSubject> subject = factory();
+                Serve(*channel, *subject);
+            } catch (...) {
+                status = 1;
+            }
+            _exit(status);
+        }
+        if (this->transport_ == kSharedMemory) {
+            // Polling with WNOHANG reaps a dead server, so remember that the
+            // destructor has nobody left to wait for.
+            this->channel_ = std::make_unique<ShmChannel>(to_server, to_client, [this] {
+                if (this->server_reaped_) {
+                    return false;
+                }
+                pid_t reaped = waitpid(this->server_, nullptr, WNOHANG);
+                this->server_reaped_ = reaped == this->server_;
+                return reaped == 0;
+            });
+        } else {
+            close(sockets[1]);
+            this->channel_ = std::make_unique<SocketChannel>(sockets[0]);
+        }
+    }
+    ~RemoteProxy() {
+        try {
+            std::string frame;
+            AppendFrame(frame, kShutdown, 0, "");
+            this->channel_->Write(frame.data(), frame.size());
+        } catch (const std::runtime_error &) {
+            // The server is already gone.
+        }
+        if (!this->server_reaped_) {
+            while (waitpid(this->server_, nullptr, 0) < 0 && errno == EINTR) {
+            }
+        }
+        this->channel_.reset();
+        if (this->shared_ != MAP_FAILED) {
+            munmap(this->shared_, this->shared_bytes_);
+        }
+    }
+    RemoteProxy(const RemoteProxy &) = delete;
+    RemoteProxy &operator=(const RemoteProxy &) = delete;
+
+    std::string Request(const std::string &key) const override {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        std::uint64_t id = this->next_id_++;
+        std::string frame;
+        AppendFrame(frame, kRequest, id, key);
+        this->channel_->Write(frame.data(), frame.size());
+        std::string value;
+        if (this->ReadReply(id, value) == kError) {
+            throw std::runtime_error(value);
+        }
+        return value;
+    }
+    std::vector<std::string> RequestBatch(const std::vector<std::string> &keys) const override {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        std::uint64_t id = this->next_id_++;
+        std::string frame;
+        AppendFrame(frame, kBatch, id, Pack(keys));
+        this->channel_->Write(frame.data(), frame.size());
+        std::string values;
+        if (this->ReadReply(id, values) == kError) {
+            throw std::runtime_error(values);
+        }
+        return Unpack(values);
+    }
+    /**
+   * Answers `keys` in order with one subject Request() each, but without
+   * waiting for each reply before sending the next request. The window is
+   * topped up in one write whenever half of it has been answered.
+   */
+    std::vector<std::string> Pipeline(const std::vector<std::string> &keys, std::size_t depth = 64) const {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        depth = std::max<std::size_t>(depth, 1);
+        std::uint64_t first = this->next_id_;
+        this->next_id_ += keys.size();
+        std::vector<std::string> values(keys.size());
+        std::string frames;
+        std::string error;
+        std::size_t sent = 0;
+        for (std::size_t received = 0; received < keys.size(); ++received) {
+            if (sent - received <= depth / 2) {
+                frames.clear();
+                for (; sent < keys.size() && sent - received < depth; ++sent) {
+                    AppendFrame(frames, kRequest, first + sent, keys[sent]);
+                }
+                if (!frames.empty()) {
+                    this->channel_->Write(frames.data(), frames.size());
+                }
+            }
+            if (this->ReadReply(first + received, values[received]) == kError && error.empty()) {
+                error = values[received];
+            }
+        }
+        if (!error.empty()) {
+            throw std::runtime_error(error);
+        }
+        return values;
+    }
+    Transport transport() const {
+        return this->transport_;
+    }
+};
+
 void ClientCode(const Subject &Subject){
         //..
         Subject.Request();
         //...
 }
 
-int main()
+/**
+ * Resident set size of this process, from /proc/self/statm.
+ */
+long ResidentBytes() {
+    std::ifstream statm("/proc/self/statm");
+    long pages = 0;
+    long resident = 0;
+    statm >> pages >> resident;
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+/**
+ * Builds `count` 64 KiB HeavySubjects up front and behind LazyProxies, touches
+ * one in `touch_every` of them, and compares time and memory. Then times the
+ * steady-state Request() of a loaded LazyProxy against a direct call.
+ */
+void BenchmarkLazyProxy(std::size_t count, std::size_t touch_every) {
+    using Clock = std::chrono::steady_clock;
+    const std::size_t bytes = 64 << 10;
+    std::cout << count << " subjects of " << (bytes >> 10) << " KiB, one in " << touch_every << " used\n";
+    {
+        long rss = ResidentBytes();
+        auto start = Clock::now();
+        std::vector<std::unique_ptr<LazyProxy>> lazy;
+        for (std::size_t i = 0; i < count; ++i) {
+            lazy.push_back(std::make_unique<LazyProxy>([bytes] { return std::make_unique<HeavySubject>(bytes); }));
+        }
+        double startup_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        for (std::size_t i = 0; i < count; i += touch_every) {
+            lazy[i]->Request();
+        }
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        std::cout << "  lazy:  " << ms << " ms (" << startup_ms << " ms to create the proxies), "
+                  << ((ResidentBytes() - rss) >> 20) << " MiB\n";
+    }
+
+    {
+        long rss = ResidentBytes();
+        auto start = Clock::now();
+        std::vector<std::unique_ptr<Subject>> eager;
+        for (std::size_t i = 0; i < count; ++i) {
+            eager.push_back(std::make_unique<HeavySubject>(bytes));
+        }
+        for (std::size_t i = 0; i < count; i += touch_every) {
+            eager[i]->Request();
+        }
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        std::cout << "  eager: " << ms << " ms, " << ((ResidentBytes() - rss) >> 20) << " MiB\n";
+    }
+    const int calls = 10000000;
+    HeavySubject direct(bytes);
+    LazyProxy lazy([bytes] { return std::make_unique<HeavySubject>(bytes); });
+    LazyProxy unloadable([bytes] { return std::make_unique<HeavySubject>(bytes); }, std::chrono::seconds(1));
+    const Subject *subjects[] = {&direct, &lazy, &unloadable};
+    const char *names[] = {"direct HeavySubject", "LazyProxy", "LazyProxy with idle unload"};
+    for (int s = 0; s < 3; ++s) {
+        subjects[s]->Request();
+        auto start = Clock::now();
+        for (int i = 0; i < calls; ++i) {
+            subjects[s]->Request();
+        }
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / calls;
+        std::cout << "  " << names[s] << ": " << ns << " ns per Request()\n";
+    }
+}
+
+/**
+ * A subject that does nothing, to isolate the cost of the proxy around it.
+ */
+class NullSubject : public Subject
+{
+public:
+    void Request() const override {}
+};
+
+struct RequestLatency {
+    std::int64_t p50;
+    std::int64_t p99;
+    std::int64_t p999;
+};
+
+/**
+ * Times `requests` individual Request() calls, timer overhead included. With a
+ * non-zero `burst`, `settle` runs untimed after every `burst` requests, so a
+ * background thread can catch up between them.
+ */
+RequestLatency MeasureRequestLatency(const Subject &subject, std::size_t requests, std::size_t burst = 0,
+                                     const std::function<void()> &settle = nullptr) {
+    using Clock = std::chrono::steady_clock;
+    std::vector<std::int64_t> samples(requests);
+    for (std::size_t i = 0; i < requests; ++i) {
+        auto start = Clock::now();
+        subject.Request();
+        samples[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+        if (burst && (i + 1) % burst == 0) {
+            settle();
+        }
+    }
+    std::sort(samples.begin(), samples.end());
+    return RequestLatency{samples[requests / 2], samples[requests * 99 / 100], samples[requests * 999 / 1000]};
+}
+
+/**
+ * Prints `latency`, or with a `baseline` only what it adds on top of it.
+ */
+void PrintRequestLatency(const char *name, const RequestLatency &latency, const RequestLatency *baseline = nullptr) {
+    if (!baseline) {
+        std::cout << "  " << name << ": p50 " << latency.p50 << " ns, p99 " << latency.p99 << " ns, p99.9 "
+                  << latency.p999 << " ns\n";
+        return;
+    }
+    std::cout << "  " << name << ": p50 +" << latency.p50 - baseline->p50 << " ns, p99 +"
+              << latency.p99 - baseline->p99 << " ns, p99.9 +" << latency.p999 - baseline->p999 << " ns\n";
+}
+
+/**
+ * Per-request latency with no logging, then what synchronous formatted logging
+ * to a file under a mutex (the shape of Proxy's std::cout logging) and
+ * AsyncLogger add to it; then several threads flooding small rings to show
+ * drops.
+ */
+void BenchmarkAsyncLogging(std::size_t requests, const std::string &path) {
+    NullSubject null_subject;
+    std::cout << requests << " requests through a proxy around an empty subject\n";
+    RequestLatency baseline = MeasureRequestLatency(null_subject, requests);
+    PrintRequestLatency("no logging          ", baseline);
+
+    class SyncLoggingProxy : public Subject
+    {
+    private:
+        const Subject *real_subject_;
+        std::FILE *file_;
+        mutable std::mutex mutex_;
+        mutable std::uint64_t sequence_ = 0;
+
+    public:
+        SyncLoggingProxy(const Subject *real_subject, std::FILE *file)
+            : real_subject_{real_subject}, file_{file}
+            {}
+        void Request() const override {
+            std::lock_guard<std::mutex> lock(this->mutex_);
+            std::int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+            std::fprintf(this->file_, "%lld #%llu check-access\n", static_cast<long long>(now),
+                         static_cast<unsigned long long>(this->sequence_));
+            this->real_subject_->Request();
+            std::fprintf(this->file_, "%lld #%llu request\n", static_cast<long long>(now),
+                         static_cast<unsigned long long>(this->sequence_++));
+        }
+    };
+    {
+        std::FILE *file = std::fopen(path.c_str(), "w");
+        SyncLoggingProxy sync(&null_subject, file);
+        PrintRequestLatency("synchronous logging ", MeasureRequestLatency(sync, requests), &baseline);
+        std::fclose(file);
+    }
+    {
+        // Bursts fill at most half a ring and the drainer empties it between
+        // them, so every timed request really logs both of its records.
+        const std::size_t ring_capacity = 4096;
+        AsyncLogger logger(path, ring_capacity);
+        LoggingProxy async(&null_subject, &logger);
+        std::uint64_t logged = 0;
+        auto drained = [&] {
+            while (logger.written() + logger.dropped() < logged) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        };
+        RequestLatency latency = MeasureRequestLatency(async, requests, ring_capacity / 4, [&] {
+            logged += ring_capacity / 2;
+            drained();
+        });
+        logged = 2 * requests;
+        drained();
+        PrintRequestLatency("AsyncLogger         ", latency, &baseline);
+        std::cout << "    " << logger.written() << " of " << logged << " records written\n";
+    }
+
+    for (std::size_t capacity : {1u << 10, 1u << 14}) {
+        AsyncLogger logger(path, capacity);
+        LoggingProxy async(&null_subject, &logger);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&async, requests] {
+                for (std::size_t i = 0; i < requests; ++i) {
+                    async.Request();
+                }
+            });
+        }
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+        std::uint64_t dropped = logger.dropped();
+        std::cout << "  overload, 4 threads, rings of " << capacity << ": " << dropped << " of " << 8 * requests
+                  << " records dropped\n";
+    }
+    std::remove(path.c_str());
+}
+
+/**
+ * Draws keys 0 .. n-1 with probability proportional to 1 / (rank + 1)^s, the
+ * skew typical of request traffic.
+ */
+class ZipfGenerator
+{
+private:
+    std::vector<double> cdf_;
+
+public:
+    ZipfGenerator(std::size_t n, double s)
+        : cdf_(n)
+    {
+        double total = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            total += 1.0 / std::pow(static_cast<double>(i + 1), s);
+            this->cdf_[i] = total;
+        }
+        for (double &c : this->cdf_) {
+            c /= total;
+        }
+    }
+    template <typename Rng>
+    std::size_t operator()(Rng &rng) const {
+        double u = std::uniform_real_distribution<double>(0, 1)(rng);
+        return static_cast<std::size_t>(std::lower_bound(this->cdf_.begin(), this->cdf_.end(), u) - this->cdf_.begin());
+    }
+};
+
+/**
+ * Serves `requests` Zipf-distributed keys out of `keys` through a CachingProxy
+ * in front of a 20 us SlowSubject, for several cache budgets and thread counts
+ * and one short TTL, and compares with calling the subject directly.
+ */
+void BenchmarkCachingProxy(std::size_t keys, std::size_t requests) {
+    using Clock = std::chrono::steady_clock;
+    SlowSubject slow(std::chrono::microseconds(20));
+    ZipfGenerator zipf(keys, 0.99);
+    std::vector<std::string> names(keys);
+    for (std::size_t i = 0; i < keys; ++i) {
+        names[i] = "key-" + std::to_string(i);
+    }
+
+    std::mt19937_64 rng(1);
+    std::size_t direct_requests = requests / 20;
+    auto start = Clock::now();
+    for (std::size_t i = 0; i < direct_requests; ++i) {
+        slow.Request(names[zipf(rng)]);
+    }
+    double direct_us = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / direct_requests;
+    std::cout << requests << " requests over " << keys << " Zipf(0.99) keys, subject latency 20 us\n"
+              << "  direct: " << direct_us << " us per request\n";
+
+    struct Config {
+        std::size_t budget;
+        std::size_t threads;
+        std::chrono::milliseconds ttl;
+    };
+    for (Config config : {Config{1 << 20, 1, std::chrono::minutes(1)}, Config{1 << 20, 4, std::chrono::minutes(1)},
+                          Config{4 << 20, 1, std::chrono::minutes(1)}, Config{4 << 20, 4, std::chrono::minutes(1)},
+                          Config{16 << 20, 1, std::chrono::minutes(1)}, Config{16 << 20, 4, std::chrono::minutes(1)},
+                          Config{16 << 20, 1, std::chrono::milliseconds(50)}}) {
+        std::size_t threads = config.threads;
+        CachingProxy proxy(&slow, config.budget, config.ttl);
+        start = Clock::now();
+        std::vector<std::thread> workers;
+        for (std::size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                std::mt19937_64 local(t + 2);
+                for (std::size_t i = t; i < requests; i += threads) {
+                    proxy.Request(names[zipf(local)]);
+                }
+            });
+        }
+        for (std::thread &worker : workers) {
+            worker.join();
+        }
+        double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / requests;
+        CachingProxy::Stats stats = proxy.stats();
+        std::cout << "  budget " << (config.budget >> 20) << " MiB, ttl " << config.ttl.count() << " ms, "
+                  << threads << " threads: " << us << " us per request, hit rate "
+                  << 100.0 * stats.hits / requests << "%\n"
+                  << "    " << stats << "\n";
+    }
+}
+
+/**
+ * A thundering herd: each of `rounds` rounds releases `threads` threads at once
+ * against a SlowSubject that sleeps 200 us per call, first all asking for one hot key, then each
+ * for a different key. Counts backend calls and time per round when calling
+ * the subject directly, through a CoalescingProxy, and through one that also
+ * batches within a 50 us window.
+ */
+void BenchmarkCoalescingProxy(std::size_t threads, std::size_t rounds) {
+    using Clock = std::chrono::steady_clock;
+    std::cout << threads << " threads x " << rounds << " rounds, subject sleeps 200 us per call\n";
+    for (bool hot_key : {true, false}) {
+        std::cout << (hot_key ? "  every thread asks for the same key\n" : "  every thread asks for its own key\n");
+        for (int mode = 0; mode < 3; ++mode) {
+            SlowSubject slow(std::chrono::microseconds(200), 64, SlowSubject::kSleep);
+            CoalescingProxy coalescing(&slow);
+            CoalescingProxy batching(&slow, std::chrono::microseconds(50));
+            const KeyedSubject *subject = mode == 0 ? static_cast<const KeyedSubject *>(&slow)
+                                        : mode == 1 ? static_cast<const KeyedSubject *>(&coalescing) : &batching;
+
+            std::mutex mutex;
+            std::condition_variable changed;
+            std::size_t round = 0;
+            std::size_t finished = 0;
+            std::vector<std::thread> workers;
+            for (std::size_t t = 0; t < threads; ++t) {
+                workers.emplace_back([&, t] {
+                    for (std::size_t r = 1; r <= rounds; ++r) {
+                        {
+                            std::unique_lock<std::mutex> lock(mutex);
+                            changed.wait(lock, [&] { return round >= r; });
+                        }
+                        subject->Request("key-" + std::to_string(hot_key ? r : r * threads + t));
+                        std::lock_guard<std::mutex> lock(mutex);
+                        if (++finished == threads) {
+                            changed.notify_all();
+                        }
+                    }
+                });
+            }
+            auto start = Clock::now();
+            for (std::size_t r = 1; r <= rounds; ++r) {
+                std::unique_lock<std::mutex> lock(mutex);
+                finished = 0;
+                round = r;
+                changed.notify_all();
+                changed.wait(lock, [&] { return finished == threads; });
+            }
+            double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / rounds;
+            for (std::thread &worker : workers) {
+                worker.join();
+            }
+            const char *name = mode == 0 ? "direct    " : mode == 1 ? "coalescing" : "batching  ";
+            std::cout << "    " << name << ": " << slow.calls() << " backend calls for " << threads * rounds
+                      << " requests, " << us << " us per round\n";
+        }
+    }
+}
+
+/**
+ * Round-trip latency and throughput of RemoteProxy over each transport, for a
+ * subject that answers at once, against calling that subject in process:
+ * `requests` single requests one at a time, then through Pipeline() with 64
+ * in flight and through RequestBatch() of 64 keys.
+ */
+void BenchmarkRemoteProxy(std::size_t requests) {
+    using Clock = std::chrono::steady_clock;
+    std::vector<std::string> keys(requests);
+    for (std::size_t i = 0; i < requests; ++i) {
+        keys[i] = "key-" + std::to_string(i % 1024);
+    }
+    auto make_subject = []() -> std::unique_ptr<KeyedSubject> {
+        return std::make_unique<SlowSubject>(std::chrono::nanoseconds(0));
+    };
+    auto per_second = [requests](Clock::time_point start) {
+        return requests / std::chrono::duration<double>(Clock::now() - start).count();
+    };
+    auto one_at_a_time = [&](const char *name, const KeyedSubject &subject) {
+        std::vector<std::int64_t> samples(requests);
+        auto start = Clock::now();
+        for (std::size_t i = 0; i < requests; ++i) {
+            auto sent = Clock::now();
+            subject.Request(keys[i]);
+            samples[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - sent).count();
+        }
+        double rate = per_second(start);
+        std::sort(samples.begin(), samples.end());
+        std::cout << "  " << name << ": p50 " << samples[requests / 2] << " ns, p99 " << samples[requests * 99 / 100]
+                  << " ns, " << rate << " requests/s one at a time\n";
+    };
+
+    std::cout << requests << " requests to a subject that answers at once, " << std::thread::hardware_concurrency()
+              << " core(s)\n";
+    std::unique_ptr<KeyedSubject> local = make_subject();
+    one_at_a_time("in process   ", *local);
+    for (RemoteProxy::Transport transport : {RemoteProxy::kSharedMemory, RemoteProxy::kSocket}) {
+        RemoteProxy remote(make_subject, transport);
+        one_at_a_time(transport == RemoteProxy::kSharedMemory ? "shared memory" : "socket       ", remote);
+        auto start = Clock::now();
+        remote.Pipeline(keys, 64);
+        double pipelined = per_second(start);
+        start = Clock::now();
+        for (std::size_t i = 0; i < requests; i += 64) {
+            remote.RequestBatch(std::vector<std::string>(keys.begin() + i,
+                                                         keys.begin() + std::min(i + 64, requests)));
+        }
+        double batched = per_second(start);
+        std::cout << "    " << pipelined << " requests/s pipelined, " << batched << " requests/s in batches of 64\n";
+    }
+}
+
+int main(int argc, char *argv[])
 {
     std::cout << "Client: Executing the client code with a real subject: \n";
     auto real_subject = std::make_unique<RealSubject>();
@@ -89,4 +1896,80 @@ int main()
     auto proxy = std::make_unique<Proxy>(real_subject.get());
     ClientCode(*proxy);
 
+    std::cout << "\nClient: Asking a caching proxy for the same keys twice: \n";
+    SlowSubject slow(std::chrono::milliseconds(1));
+    CachingProxy cache(&slow, 1 << 20, std::chrono::seconds(60));
+    for (const char *key : {"apple", "pear", "apple", "apple", "pear"}) {
+        cache.Request(key);
+    }
+    std::cout << "CachingProxy: " << cache.stats() << ", " << slow.calls() << " real requests\n";
+
+    std::cout << "\nClient: Eight threads ask a coalescing proxy for the same key at once: \n";
+    SlowSubject remote(std::chrono::milliseconds(20), 64, SlowSubject::kSleep);
+    CoalescingProxy coalescing(&remote);
+    std::vector<std::thread> herd;
+    for (int i = 0; i < 8; ++i) {
+        herd.emplace_back([&coalescing] { coalescing.Request("banana"); });
+    }
+    for (std::thread &caller : herd) {
+        caller.join();
+    }
+    std::cout << "CoalescingProxy: " << coalescing.stats() << ", " << remote.calls() << " real requests\n";
+
+    std::cout << "\nClient: Four threads make the first request through a lazy proxy at once: \n";
+    LazyProxy lazy([] {
+        std::cout << "LazyProxy: Constructing the RealSubject.\n";
+        return std::make_unique<RealSubject>();
+    }, std::chrono::milliseconds(10));
+    std::vector<std::thread> first_callers;
+    for (int i = 0; i < 4; ++i) {
+        first_callers.emplace_back([&lazy] { ClientCode(lazy); });
+    }
+    for (std::thread &caller : first_callers) {
+        caller.join();
+    }
+    std::cout << "LazyProxy: " << lazy.loads() << " construction(s)\n";
+    {
+        IdleReaper reaper(std::chrono::milliseconds(5));
+        reaper.Watch(&lazy);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    std::cout << "LazyProxy: Still loaded after 50 ms idle: " << (lazy.loaded() ? "yes" : "no") << "\n";
+    ClientCode(lazy);
+
+    std::cout << "\nClient: The same request through a proxy that logs asynchronously: \n";
+    {
+        AsyncLogger logger("proxy_access.log");
+        LoggingProxy logging(real_subject.get(), &logger);
+        ClientCode(logging);
+        ClientCode(logging);
+    }
+    std::ifstream log("proxy_access.log");
+    for (std::string line; std::getline(log, line);) {
+        std::cout << "proxy_access.log: " << line.substr(line.find(' ') + 1) << "\n";
+    }
+    std::remove("proxy_access.log");
+
+    std::cout << "\nClient: Asking a subject that runs in another process: \n";
+    {
+        RemoteProxy remote([]() -> std::unique_ptr<KeyedSubject> {
+            return std::make_unique<SlowSubject>(std::chrono::nanoseconds(0), 0);
+        });
+        std::cout << "RemoteProxy ("
+                  << (remote.transport() == RemoteProxy::kSharedMemory ? "shared memory" : "socket") << "): "
+                  << remote.Request("apple") << "\n";
+        for (const std::string &value : remote.RequestBatch({"pear", "plum"})) {
+            std::cout << "RemoteProxy (batch): " << value << "\n";
+        }
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        std::cout << "\n";
+        BenchmarkCachingProxy(100000, 500000);
+        BenchmarkCoalescingProxy(16, 200);
+        BenchmarkLazyProxy(20000, 100);
+        BenchmarkAsyncLogging(1000000, "proxy_bench.log");
+        BenchmarkRemoteProxy(100000);
+    }
+
 }
\ No newline at end of file